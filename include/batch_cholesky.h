@@ -0,0 +1,206 @@
+/*
+ * batch_cholesky.h
+ * Copyright 2016 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * Check whether many small symmetric matrices are positive definite at once.
+ *
+ * For the matrices of size 3 to 10 which make up vertices and edges, a LAPACK
+ * potrf call spends most of its time in call overhead and blocking logic.
+ * Instead the matrices are stored as a structure of arrays, with each entry of
+ * lanes matrices held next to each other, and a cholesky decomposition is run
+ * on all of them at once. Each step of the decomposition is a loop over the
+ * lanes which the compiler vectorises. Only whether each decomposition
+ * succeeds is kept.
+ *
+ * All the matrices in a batch can share a leading block of rows and columns,
+ * given by its cholesky factor. Then only the remaining rows and columns of
+ * each matrix are stored and factored, so that checking many extensions of
+ * the same matrix costs no more than solving against the shared factor.
+ *
+ * Most matrices are clearly definite or clearly not, so in a large batch
+ * screen_lanes matrices at a time are first factored in single precision,
+ * which fits twice as many in each vector. Only the groups containing a matrix
+ * which this cannot decide are factored again in double precision. Smaller
+ * batches are factored in double precision straight away, as padding them out
+ * to screen_lanes costs more than the screen saves.
+ */
+#pragma once
+#ifndef PTOPE_BATCH_CHOLESKY_H_
+#define PTOPE_BATCH_CHOLESKY_H_
+
+#include <armadillo>
+#include <vector>
+
+namespace ptope {
+class BatchCholesky {
+public:
+	/** Number of matrices factored together. */
+	static constexpr std::size_t lanes = 8;
+	/** Number of matrices factored together in single precision. */
+	static constexpr std::size_t screen_lanes = 2 * lanes;
+	/** Margin used by the single precision screen unless changed. */
+	static constexpr float default_screen_margin = 1e-4f;
+
+	BatchCholesky();
+	/** Start a new batch of size x size matrices. */
+	void
+	reset(std::size_t size);
+	/**
+	 * Start a new batch of size x size matrices, each with the same leading
+	 * shared x shared block. The upper triangle of chol holds the cholesky
+	 * factor U of this block, where block = U^T U, and must not change until
+	 * the batch has been run.
+	 */
+	void
+	reset(std::size_t size, const arma::mat & chol, std::size_t shared);
+	/** Remove all matrices from the batch, keeping its size and shared block. */
+	void
+	clear();
+	/**
+	 * Add the submatrix of m on the given indices to the batch. The indices can
+	 * be any container with operator[], and only the upper triangle outside the
+	 * shared block is read.
+	 */
+	template <class Indices>
+	void
+	add(const arma::mat & m, const Indices & indices);
+	/**
+	 * Add the matrix stored column by column from mat, with each column
+	 * starting ld entries after the last. Only the upper triangle outside the
+	 * shared block is read.
+	 */
+	void
+	add(const double * mat, std::size_t ld);
+	/** Factor every matrix added since the batch was started or cleared. */
+	void
+	run();
+	/**
+	 * Set the margin used by the single precision screen. Each pivot
+	 * p = a_jj - s, where s is the sum of squares of the entries above it in
+	 * the factor, has rounding error of about n * u * (a_jj + s) for unit
+	 * roundoff u, scaled by 1 / r, where r is the smallest relative pivot
+	 * p / (a_jj + s) met earlier in the factorisation, including those of the
+	 * shared factor. A small earlier pivot is the difference of nearly equal
+	 * values, so every entry divided by it is inaccurate.
+	 *
+	 * A pivot is only trusted if it is further than margin * (a_jj + s) / r
+	 * from zero, so the margin must be well above n * u, about 1e-6 for
+	 * matrices of size 10 in single precision. A matrix with any pivot closer to
+	 * zero than this is ambiguous, and is factored in double precision. A
+	 * margin of zero turns the screen off.
+	 */
+	void
+	set_screen_margin(float margin) {
+		_margin = margin;
+	}
+	float
+	screen_margin() const {
+		return _margin;
+	}
+	/** Number of matrices in the last run which were screened. */
+	std::size_t
+	screened() const {
+		return _screened;
+	}
+	/**
+	 * Number of screened matrices in the last run which could not be decided,
+	 * and so were factored in double precision.
+	 */
+	std::size_t
+	ambiguous() const {
+		return _ambiguous;
+	}
+	/** Number of matrices in the batch. */
+	std::size_t
+	size() const {
+		return _count;
+	}
+	/** Whether the i-th matrix added was found to be positive definite. */
+	bool
+	positive_definite(std::size_t i) const {
+		return _positive[i] != 0;
+	}
+private:
+	std::size_t _size;
+	std::size_t _shared;
+	/** Shared factor and the distance between its columns. */
+	const double * _chol;
+	std::size_t _ld;
+	/**
+	 * Position of the first entry of each column in a group, counted in
+	 * entries of all lanes. Only columns from _shared are stored.
+	 */
+	std::vector<std::size_t> _offsets;
+	/** Number of entries of all lanes in a group of matrices. */
+	std::size_t _group_size;
+	/** Upper triangles of each group of lanes matrices, entry by entry. */
+	std::vector<double> _data;
+	std::vector<unsigned char> _positive;
+	std::size_t _count;
+	float _margin;
+	std::size_t _screened;
+	std::size_t _ambiguous;
+	/** Single precision copy of one pair of groups, and of the shared factor. */
+	std::vector<float> _screen_data;
+	std::vector<float> _screen_chol;
+	/** Whether _screen_chol holds the current shared factor. */
+	bool _screen_chol_ready;
+	/** Smallest relative pivot of the shared factor, or 1 if there is none. */
+	float _shared_pivot;
+	/** Result of the screen for each lane of a pair of groups. */
+	unsigned char _screen[screen_lanes];
+
+	/** Get the entry (i, j), i <= j, of the next matrix to be added. */
+	double &
+	next_entry(std::size_t i, std::size_t j) {
+		return _data[(_count / lanes) * _group_size
+			+ (_offsets[j] + i) * lanes + _count % lanes];
+	}
+	/** Make room for the next matrix, starting a new group if needed. */
+	void
+	prepare_next();
+	/**
+	 * Factor the group of matrices starting at data, of which only the first
+	 * Used lanes hold matrices.
+	 */
+	template <std::size_t Used>
+	void
+	factor_group(double * data, unsigned char * positive) const;
+	/** Factor the group starting at data, of which used lanes hold matrices. */
+	void
+	factor_group(double * data, unsigned char * positive, std::size_t used)
+		const;
+	/**
+	 * Screen the pair of groups starting at group first, which holds used
+	 * matrices, filling _screen and _positive for each.
+	 */
+	void
+	screen_groups(std::size_t first, std::size_t used);
+};
+template <class Indices>
+void
+BatchCholesky::add(const arma::mat & m, const Indices & indices) {
+	prepare_next();
+	for(std::size_t j = _shared; j < _size; ++j) {
+		const double * col = m.colptr(indices[j]);
+		for(std::size_t i = 0; i <= j; ++i) {
+			next_entry(i, j) = col[indices[i]];
+		}
+	}
+	++_count;
+}
+}
+#endif
@@ -16,25 +16,76 @@
  */
 /**
  * Functor which checks whether a given matrix is block diagonal or not (after
- * some permutation). It returns true if the matrix is block diagonal.
+ * some permutation). It returns true if the matrix is connected, so is not
+ * block diagonal.
+ *
+ * The matrix, or the submatrix on a list of indices, can also be split into
+ * its connected components. The buffers holding the components are kept, so
+ * that repeated calls do not allocate.
  */
 #pragma once
 #ifndef PTOPE_BLOCK_DIAGONAL_CHECK_H_
 #define PTOPE_BLOCK_DIAGONAL_CHECK_H_
 
 #include <armadillo>
-#include <queue>
+#include <vector>
 
 namespace ptope {
 class BlockDiagonalCheck {
 	public:
-		BlockDiagonalCheck() {}
-		bool operator()(const arma::mat m);
+		/** Indices into the matrix of the vectors in a component. */
+		typedef std::vector<arma::uword> Component;
+
+		BlockDiagonalCheck() : _components(), _n_components(0), _unvisited() {}
+		bool operator()(const arma::mat & m);
+		/**
+		 * Split the matrix into connected components.
+		 * Return: the number of components
+		 */
+		std::size_t
+		decompose(const arma::mat & m);
+		/**
+		 * Split the submatrix on the given indices into connected components. The
+		 * indices can be any container with size() and operator[].
+		 * Return: the number of components
+		 */
+		template <class Indices>
+		std::size_t
+		decompose(const arma::mat & m, const Indices & indices);
+		/** Number of components found by the last decomposition. */
+		std::size_t
+		n_components() const {
+			return _n_components;
+		}
+		/** Get the i-th component found by the last decomposition. */
+		const Component &
+		component(std::size_t i) const {
+			return _components[i];
+		}
 	private:
+		/** Only the first _n_components entries are in use. */
+		std::vector<Component> _components;
+		std::size_t _n_components;
 		std::vector<arma::uword> _unvisited;
-		std::vector<std::vector<arma::uword>> _components;
-		std::queue<arma::uword> _queue;
+
+		/** Split the vectors in _unvisited into components. */
+		std::size_t
+		priv_decompose(const arma::mat & m);
 };
+inline
+bool
+BlockDiagonalCheck::operator()(const arma::mat & m) {
+	return decompose(m) == 1;
+}
+template <class Indices>
+inline
+std::size_t
+BlockDiagonalCheck::decompose(const arma::mat & m, const Indices & indices) {
+	_unvisited.clear();
+	for(std::size_t i = 0, max = indices.size(); i < max; ++i) {
+		_unvisited.push_back(indices[i]);
+	}
+	return priv_decompose(m);
+}
 }
 #endif
-
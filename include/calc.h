@@ -113,6 +113,15 @@ mink_sq_norm(const arma::vec & a) {
 	double m = a[max] * a[max];
 	return eucl - m;
 }
+/**
+ * Whether the inner product between two unit vectors corresponds to a dotted
+ * edge, using the same tolerance as NumberDottedCheck.
+ */
+bool
+inline
+is_dotted(double prod) {
+	return prod + 1.0 < 1e-14;
+}
 
 }
 }
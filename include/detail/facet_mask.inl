@@ -0,0 +1,126 @@
+template <std::size_t Words>
+constexpr std::size_t FacetMask<Words>::max_facets;
+
+template <std::size_t Words>
+inline
+std::size_t
+FacetMask<Words>::count() const {
+	std::size_t result = 0;
+	for(const std::uint64_t & word : _words) {
+		result += __builtin_popcountll(word);
+	}
+	return result;
+}
+template <std::size_t Words>
+inline
+bool
+FacetMask<Words>::none() const {
+	for(const std::uint64_t & word : _words) {
+		if(word != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+template <std::size_t Words>
+inline
+std::size_t
+FacetMask<Words>::first() const {
+	for(std::size_t w = 0; w < Words; ++w) {
+		if(_words[w] != 0) {
+			return 64 * w + __builtin_ctzll(_words[w]);
+		}
+	}
+	return max_facets;
+}
+template <std::size_t Words>
+template <class F>
+inline
+void
+FacetMask<Words>::for_each(F f) const {
+	for(std::size_t w = 0; w < Words; ++w) {
+		std::uint64_t word = _words[w];
+		while(word != 0) {
+			f(64 * w + __builtin_ctzll(word));
+			// Clear the lowest set bit.
+			word &= word - 1;
+		}
+	}
+}
+// Mix each word with the finaliser from splitmix64, so that masks differing
+// in a single facet land in unrelated slots.
+template <std::size_t Words>
+inline
+std::size_t
+FacetMask<Words>::hash() const {
+	std::uint64_t result = 0;
+	for(const std::uint64_t & word : _words) {
+		std::uint64_t z = result ^ word;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		result = z ^ (z >> 31);
+	}
+	return static_cast<std::size_t>(result);
+}
+
+template <std::size_t Words>
+FacetMaskSet<Words>::FacetMaskSet()
+	: _masks()
+	, _table(64, 0)
+{}
+template <std::size_t Words>
+inline
+void
+FacetMaskSet<Words>::clear() {
+	if(!_masks.empty()) {
+		_masks.clear();
+		std::fill(_table.begin(), _table.end(), 0);
+	}
+}
+template <std::size_t Words>
+inline
+bool
+FacetMaskSet<Words>::contains(const Mask & mask) const {
+	return _table[priv_find_slot(mask)] != 0;
+}
+template <std::size_t Words>
+inline
+bool
+FacetMaskSet<Words>::add(const Mask & mask) {
+	std::size_t slot = priv_find_slot(mask);
+	if(_table[slot] != 0) {
+		return false;
+	}
+	_masks.push_back(mask);
+	_table[slot] = _masks.size();
+	// Keep the load factor below a half, so probe sequences stay short.
+	if(2 * _masks.size() > _table.size()) {
+		priv_grow();
+	}
+	return true;
+}
+template <std::size_t Words>
+inline
+std::size_t
+FacetMaskSet<Words>::priv_find_slot(const Mask & mask) const {
+	// The table size is always a power of two.
+	const std::size_t modulo = _table.size() - 1;
+	std::size_t slot = mask.hash() & modulo;
+	while(_table[slot] != 0 && _masks[_table[slot] - 1] != mask) {
+		slot = (slot + 1) & modulo;
+	}
+	return slot;
+}
+template <std::size_t Words>
+void
+FacetMaskSet<Words>::priv_grow() {
+	_table.assign(2 * _table.size(), 0);
+	const std::size_t modulo = _table.size() - 1;
+	for(std::size_t i = 0, max = _masks.size(); i < max; ++i) {
+		std::size_t slot = _masks[i].hash() & modulo;
+		while(_table[slot] != 0) {
+			slot = (slot + 1) & modulo;
+		}
+		_table[slot] = i + 1;
+	}
+}
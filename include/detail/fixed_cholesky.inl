@@ -0,0 +1,56 @@
+#include <cmath>
+
+namespace ptope {
+namespace fixed_cholesky {
+template <std::size_t Size>
+inline
+bool
+chol_in_place(double * mat, std::size_t ld) {
+	for(std::size_t j = 0; j < Size; ++j) {
+		double * col_j = mat + j * ld;
+		for(std::size_t i = 0; i < j; ++i) {
+			double const * col_i = mat + i * ld;
+			double dot = 0;
+			for(std::size_t k = 0; k < i; ++k) {
+				dot += col_i[k] * col_j[k];
+			}
+			col_j[i] = (col_j[i] - dot) * (1.0 / col_i[i]);
+		}
+		double sq_norm = 0;
+		for(std::size_t k = 0; k < j; ++k) {
+			sq_norm += col_j[k] * col_j[k];
+		}
+		double const pivot = col_j[j] - sq_norm;
+		if(!(pivot > 0)) {
+			return false;
+		}
+		col_j[j] = std::sqrt(pivot);
+	}
+	return true;
+}
+/*
+ * If the block is E = U^T U and the new row and column are c and g, then the
+ * extended matrix is positive definite iff g - c^T E^-1 c > 0. With y the
+ * solution of U^T y = c this is g - y^T y, so only one triangular solve is
+ * needed.
+ */
+template <std::size_t Size>
+inline
+bool
+schur_positive(double const * chol, std::size_t ld, double * col,
+		double diag) {
+	double sq_norm = 0;
+	for(std::size_t k = 0; k < Size; ++k) {
+		double const * chol_col = chol + k * ld;
+		double dot = 0;
+		for(std::size_t l = 0; l < k; ++l) {
+			dot += chol_col[l] * col[l];
+		}
+		double const val = (col[k] - dot) * (1.0 / chol_col[k]);
+		col[k] = val;
+		sq_norm += val * val;
+	}
+	return diag - sq_norm > 0;
+}
+}
+}
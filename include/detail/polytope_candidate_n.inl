@@ -0,0 +1,95 @@
+template <std::size_t D, std::size_t MaxFacets>
+constexpr std::size_t PolytopeCandidateN<D, MaxFacets>::dimension;
+template <std::size_t D, std::size_t MaxFacets>
+constexpr std::size_t PolytopeCandidateN<D, MaxFacets>::max_facets;
+template <std::size_t D, std::size_t MaxFacets>
+constexpr std::size_t PolytopeCandidateN<D, MaxFacets>::vector_size;
+
+template <std::size_t D, std::size_t MaxFacets>
+inline
+PolytopeCandidateN<D, MaxFacets> &
+PolytopeCandidateN<D, MaxFacets>::operator=(const PolytopeCandidateN & p) {
+	if(this != &p) {
+		for(std::size_t j = 0; j < p._size; ++j) {
+			std::copy(p._gram.begin() + j * MaxFacets,
+					p._gram.begin() + j * MaxFacets + p._size,
+					_gram.begin() + j * MaxFacets);
+		}
+		std::copy(p._vectors.begin(), p._vectors.begin() + p._size * vector_size,
+				_vectors.begin());
+		_size = p._size;
+		_valid = p._valid;
+	}
+	return *this;
+}
+template <std::size_t D, std::size_t MaxFacets>
+inline
+bool
+PolytopeCandidateN<D, MaxFacets>::assign(const PolytopeCandidate & p) {
+	const arma::mat & gram = p.gram();
+	const arma::mat & vectors = p.vector_family().underlying_matrix();
+	if(!p.valid() || !p.hyperbolic() || vectors.n_rows != vector_size
+			|| vectors.n_cols > MaxFacets) {
+		_size = 0;
+		_valid = false;
+		return false;
+	}
+	_size = vectors.n_cols;
+	for(std::size_t j = 0; j < _size; ++j) {
+		std::copy(gram.colptr(j), gram.colptr(j) + _size,
+				_gram.begin() + j * MaxFacets);
+	}
+	std::copy(vectors.begin(), vectors.end(), _vectors.begin());
+	_valid = true;
+	return true;
+}
+template <std::size_t D, std::size_t MaxFacets>
+inline
+void
+PolytopeCandidateN<D, MaxFacets>::to_candidate(PolytopeCandidate & result)
+		const {
+	result.assign(_gram.data(), _size, MaxFacets, _vectors.data(), vector_size,
+			_size);
+}
+template <std::size_t D, std::size_t MaxFacets>
+inline
+PolytopeCandidate
+PolytopeCandidateN<D, MaxFacets>::to_candidate() const {
+	PolytopeCandidate result;
+	to_candidate(result);
+	return result;
+}
+/* The new entries are computed as in PolytopeCandidate::extend_by_vector, so
+ * both give the same gram matrix. */
+template <std::size_t D, std::size_t MaxFacets>
+inline
+bool
+PolytopeCandidateN<D, MaxFacets>::extend_by_vector(const arma::vec & new_vec) {
+	if(_size == MaxFacets || new_vec.n_elem != vector_size) {
+		return false;
+	}
+	const std::size_t last = _size;
+	double * last_col = _gram.data() + last * MaxFacets;
+	for(std::size_t i = 0; i < last; ++i) {
+		const double val = calc::mink_inner_prod(vector_size, new_vec.memptr(),
+				vector_ptr(i));
+		last_col[i] = val;
+		_gram[i * MaxFacets + last] = val;
+	}
+	last_col[last] = calc::mink_sq_norm(new_vec);
+	std::copy(new_vec.begin(), new_vec.end(),
+			_vectors.begin() + last * vector_size);
+	++_size;
+	return true;
+}
+template <std::size_t D, std::size_t MaxFacets>
+inline
+bool
+PolytopeCandidateN<D, MaxFacets>::extend_by_vector(PolytopeCandidateN & result,
+		const arma::vec & new_vec) const {
+	if(_size == MaxFacets || new_vec.n_elem != vector_size) {
+		return false;
+	}
+	result = *this;
+	return result.extend_by_vector(new_vec);
+}
@@ -0,0 +1,113 @@
+/*
+ * elliptic_classifier.h
+ * Copyright 2016 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * Decides whether subdiagrams of a Coxeter diagram are elliptic or parabolic
+ * using only the labels on the diagram, rather than any numerical
+ * decomposition.
+ *
+ * Each entry of the gram matrix is converted to the label m of the angle pi/m
+ * using Angles. A diagram is elliptic iff each of its connected components is
+ * one of A_n, B_n, D_n, E_6, E_7, E_8, F_4, H_3, H_4 or I_2(m), which can be
+ * read off from the shape of the component and its labels. A diagram is
+ * parabolic (positive semi-definite but not positive definite) iff each of its
+ * components is either elliptic or one of the affine diagrams, and at least
+ * one is affine.
+ *
+ * Entries which do not correspond to any angle in Angles, such as dotted
+ * edges, have no label, so any subdiagram containing one cannot be classified.
+ */
+#pragma once
+#ifndef PTOPE_ELLIPTIC_CLASSIFIER_H_
+#define PTOPE_ELLIPTIC_CLASSIFIER_H_
+
+#include <armadillo>
+
+#include <vector>
+
+namespace ptope {
+class EllipticClassifier {
+public:
+	/**
+	 * NotElliptic is given to diagrams which are neither elliptic nor
+	 * parabolic.
+	 */
+	enum class Result { Elliptic, Parabolic, NotElliptic, Unknown };
+	/** Label given to entries which are not a known angle. */
+	static constexpr unsigned int no_label = 0;
+
+	EllipticClassifier();
+	/**
+	 * Compute the labels between every pair of vectors in the gram matrix,
+	 * using the angles currently set in Angles.
+	 */
+	void
+	set_gram(const arma::mat & gram);
+	/** Label of the angle between vectors i and j. */
+	unsigned int
+	label(std::size_t i, std::size_t j) const {
+		return _labels[i * _size + j];
+	}
+	/**
+	 * Classify the subdiagram on the given vectors, returning Unknown if some
+	 * pair of them has no label.
+	 *
+	 * Affine A_1 has a label of infinity, which is never in Angles, so any
+	 * diagram containing it is Unknown.
+	 */
+	Result
+	classify(const std::vector<std::size_t> & indices) const;
+private:
+	/** Number of vectors in the gram matrix. */
+	std::size_t _size;
+	/** Labels stored row by row. */
+	std::vector<unsigned int> _labels;
+	/* Scratch space reused between calls to classify. */
+	mutable std::vector<std::size_t> _component;
+	mutable std::vector<std::size_t> _degree;
+	mutable std::vector<bool> _seen;
+	mutable std::vector<std::size_t> _stack;
+
+	/** Type of a single connected component. */
+	enum class Type { Elliptic, Affine, Other };
+	/**
+	 * Find the type of the connected diagram on the vectors in _component,
+	 * given as positions in indices.
+	 */
+	Type
+	component_type(const std::vector<std::size_t> & indices) const;
+	/** Find the type of the tree with a single branch vertex. */
+	Type
+	branched_type(const std::vector<std::size_t> & indices,
+			std::size_t branch) const;
+	/** Find the type of the tree with two branch vertices. */
+	Type
+	two_branch_type(const std::vector<std::size_t> & indices) const;
+	/** Find the type of the path starting at the given end. */
+	Type
+	path_type(const std::vector<std::size_t> & indices, std::size_t end) const;
+	/** Whether every edge in _component has label 3. */
+	bool
+	simply_laced(const std::vector<std::size_t> & indices) const;
+	/** Label between the vectors at positions a and b of indices. */
+	unsigned int
+	local_label(const std::vector<std::size_t> & indices, std::size_t a,
+			std::size_t b) const {
+		return label(indices[a], indices[b]);
+	}
+};
+}
+#endif
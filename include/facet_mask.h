@@ -0,0 +1,185 @@
+/*
+ * facet_mask.h
+ * Copyright 2016 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * Fixed width bitmasks of facet indices, and a hash set of such masks.
+ *
+ * A face of a polytope is determined by the set of facets which contain it, so
+ * vertices and edges can be stored as masks with one bit per facet. Comparing,
+ * hashing and changing a single facet are then a few word operations.
+ */
+#pragma once
+#ifndef PTOPE_FACET_MASK_H_
+#define PTOPE_FACET_MASK_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace ptope {
+template <std::size_t Words>
+class FacetMask {
+public:
+	/** Number of facets which can be stored in the mask. */
+	static constexpr std::size_t max_facets = 64 * Words;
+	/** Construct an empty mask. */
+	FacetMask() : _words() {}
+	/**
+	 * Copy a mask of a different width. Any facets which do not fit in this
+	 * mask are dropped.
+	 */
+	template <std::size_t OtherWords>
+	explicit
+	FacetMask(const FacetMask<OtherWords> & other) : _words() {
+		for(std::size_t w = 0; w < Words && w < OtherWords; ++w) {
+			_words[w] = other.word(w);
+		}
+	}
+	/** Get the w-th word of 64 facets. */
+	std::uint64_t
+	word(std::size_t w) const {
+		return _words[w];
+	}
+	void
+	set(std::size_t facet) {
+		_words[facet / 64] |= bit(facet);
+	}
+	void
+	reset(std::size_t facet) {
+		_words[facet / 64] &= ~bit(facet);
+	}
+	bool
+	test(std::size_t facet) const {
+		return (_words[facet / 64] & bit(facet)) != 0;
+	}
+	/** Copy of this mask with the given facet added. */
+	FacetMask
+	with(std::size_t facet) const {
+		FacetMask result(*this);
+		result.set(facet);
+		return result;
+	}
+	/** Copy of this mask with the given facet removed. */
+	FacetMask
+	without(std::size_t facet) const {
+		FacetMask result(*this);
+		result.reset(facet);
+		return result;
+	}
+	/** Number of facets in the mask. */
+	std::size_t
+	count() const;
+	/** Whether the mask contains no facets. */
+	bool
+	none() const;
+	/** Smallest facet in the mask, or max_facets if the mask is empty. */
+	std::size_t
+	first() const;
+	/** Keep only the facets which are also in the other mask. */
+	FacetMask &
+	operator&=(const FacetMask & rhs) {
+		for(std::size_t w = 0; w < Words; ++w) {
+			_words[w] &= rhs._words[w];
+		}
+		return *this;
+	}
+	/** Remove the facets which are in the other mask. */
+	FacetMask &
+	remove(const FacetMask & rhs) {
+		for(std::size_t w = 0; w < Words; ++w) {
+			_words[w] &= ~rhs._words[w];
+		}
+		return *this;
+	}
+	/** Call f with the index of each facet in the mask, in increasing order. */
+	template <class F>
+	void
+	for_each(F f) const;
+	std::size_t
+	hash() const;
+	bool
+	operator==(const FacetMask & rhs) const {
+		return _words == rhs._words;
+	}
+	bool
+	operator!=(const FacetMask & rhs) const {
+		return _words != rhs._words;
+	}
+private:
+	std::array<std::uint64_t, Words> _words;
+
+	static
+	std::uint64_t
+	bit(std::size_t facet) {
+		return std::uint64_t(1) << (facet % 64);
+	}
+};
+/**
+ * Set of facet masks, stored in the order they were added.
+ *
+ * Lookups use an open addressing hash table with linear probing, holding the
+ * index of each mask. Clearing the set keeps all allocated memory, so the set
+ * can be reused without further allocations.
+ */
+template <std::size_t Words>
+class FacetMaskSet {
+public:
+	typedef FacetMask<Words> Mask;
+
+	FacetMaskSet();
+	/** Remove every mask from the set. No memory is released. */
+	void
+	clear();
+	std::size_t
+	size() const {
+		return _masks.size();
+	}
+	/** Check whether the mask is in the set. */
+	bool
+	contains(const Mask & mask) const;
+	/**
+	 * Add the mask to the set.
+	 * Return: true if inserted, false if already present
+	 */
+	bool
+	add(const Mask & mask);
+	/** Get the mask which was the index-th to be added. */
+	const Mask &
+	at(std::size_t index) const {
+		return _masks[index];
+	}
+private:
+	/** Masks in the order they were added. */
+	std::vector<Mask> _masks;
+	/** Hash table of 1 + index into _masks, with 0 marking an empty slot. */
+	std::vector<std::uint32_t> _table;
+
+	/**
+	 * Find the slot holding the mask, or the empty slot where it should be
+	 * inserted.
+	 */
+	std::size_t
+	priv_find_slot(const Mask & mask) const;
+	/** Double the size of the hash table. */
+	void
+	priv_grow();
+};
+
+#include "detail/facet_mask.inl"
+
+}
+#endif
@@ -0,0 +1,70 @@
+/*
+ * fixed_cholesky.h
+ * Copyright 2016 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * Cholesky kernels for the tiny blocks met when checking the vertices of a
+ * polytope. Each kernel has an instantiation for every size up to max_size, so
+ * that its loops are unrolled and the call overhead of potrf is avoided.
+ *
+ * Each entry is computed as in BatchCholesky, in the order potrf uses, so that
+ * borderline matrices are classified in the same way.
+ */
+#pragma once
+#ifndef PTOPE_FIXED_CHOLESKY_H_
+#define PTOPE_FIXED_CHOLESKY_H_
+
+#include <cstddef>
+
+namespace ptope {
+namespace fixed_cholesky {
+/**
+ * Largest size with its own instantiation, which covers every edge of a
+ * polytope of dimension at most 10.
+ */
+constexpr std::size_t max_size = 9;
+/**
+ * Replace the upper triangle of the Size x Size block at mat, whose columns
+ * start ld apart, by its cholesky factor U, where block = U^T U. Returns false
+ * if the block is not positive definite, leaving the block partly factored.
+ */
+template <std::size_t Size>
+bool
+chol_in_place(double * mat, std::size_t ld);
+/**
+ * Check whether adding the column col, with diagonal entry diag, to the matrix
+ * with the Size x Size cholesky factor at chol gives a positive definite
+ * matrix. The contents of col are overwritten by the solution y of U^T y = col.
+ */
+template <std::size_t Size>
+bool
+schur_positive(double const * chol, std::size_t ld, double * col, double diag);
+/**
+ * As chol_in_place<Size>, with the kernel for the given size picked from a
+ * table. The size must be between 1 and max_size.
+ */
+bool
+chol_in_place(double * mat, std::size_t size, std::size_t ld);
+/**
+ * As schur_positive<Size>, with the kernel for the given size picked from a
+ * table. Factors larger than max_size use the same steps in a generic loop.
+ */
+bool
+schur_positive(double const * chol, std::size_t size, std::size_t ld,
+		double * col, double diag);
+}
+}
+#include "detail/fixed_cholesky.inl"
+#endif
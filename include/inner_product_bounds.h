@@ -0,0 +1,172 @@
+/*
+ * inner_product_bounds.h
+ * Copyright 2015 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * Bounds used to prune the search over the inner product vectors which can
+ * extend a given polytope candidate.
+ *
+ * The inner products b are fixed one coordinate at a time, starting with the
+ * last. If G is the gram matrix of the basis vectors and a the nullspace
+ * vector, then any vector v with inner products b can be written as
+ * 	v = w + s a,	<w,w> = q(b) = b^T G^-1 b,
+ * so v can only be made unit if q(b) lies on the correct side of 1. Similarly
+ * for each non-basis vector u with inner products p with the basis
+ * 	<v,u> = c^T b + s <a,u>,	c = G^-1 p,
+ * and one of the two choices of sign of s must make every such product
+ * non-positive. Bounding these over all values the unfixed coordinates can
+ * take allows whole subtrees of inner product vectors to be discarded before
+ * they are constructed.
+ *
+ * The bounds are conservative, so any vector which is pruned would have been
+ * rejected by PolytopeCandidate::extend_by_inner_products.
+ *
+ * The same bounds on each <v,u> give the fewest and most dotted edges any
+ * completion can have, so a required number of dotted edges can also be used
+ * to discard subtrees.
+ *
+ * Optionally the interval of each <v,u> can also be compared against the
+ * products allowed by AngleCheck, either one of the inner products in Angles
+ * or a dotted edge. If no allowed value lies in the interval, no completion
+ * passes AngleCheck and the subtree is discarded. This changes the vectors
+ * found, so it is only done when asked for.
+ */
+#pragma once
+#ifndef PTOPE_INNER_PRODUCT_BOUNDS_H_
+#define PTOPE_INNER_PRODUCT_BOUNDS_H_
+
+#include "polytope_candidate.h"
+
+#include <limits>
+#include <vector>
+
+namespace ptope {
+class InnerProductBounds {
+public:
+	/** Allowed inner products for each basis vector. */
+	typedef std::vector<std::vector<double>> Domains;
+	/**
+	 * Allowed numbers of dotted edges between the new vector and the existing
+	 * ones, from min to max inclusive.
+	 */
+	struct DottedRange {
+		std::size_t min;
+		std::size_t max;
+		/** Any number of dotted edges. */
+		DottedRange() : min(0), max(std::numeric_limits<std::size_t>::max()) {}
+		DottedRange(std::size_t lo, std::size_t hi) : min(lo), max(hi) {}
+		/** Whether the range excludes some number of dotted edges. */
+		bool
+		restricted() const {
+			return min > 0 || max < std::numeric_limits<std::size_t>::max();
+		}
+		bool
+		contains(std::size_t count) const {
+			return min <= count && count <= max;
+		}
+	};
+	/**
+	 * Compute the bounds needed to extend the candidate using inner products
+	 * with basis vector i taken from domains[i], and having a number of dotted
+	 * edges in the given range. With check_angles, also discard vectors whose
+	 * products with the non-basis vectors cannot all pass AngleCheck.
+	 */
+	InnerProductBounds(const PolytopeCandidate & candidate,
+			const Domains & domains, const DottedRange & dotted = DottedRange(),
+			bool check_angles = false);
+	/**
+	 * Fix the coordinate at index to the given value. All coordinates after
+	 * index must already have been fixed.
+	 */
+	void
+	fix(std::size_t index, double value);
+	/**
+	 * Check whether no choice of the coordinates before index can give a valid
+	 * vector, given the coordinates fixed from index onwards.
+	 */
+	bool
+	can_prune(std::size_t index) const;
+private:
+	/** Number of coordinates in each inner product vector. */
+	std::size_t _size;
+	/** Number of non-basis vectors whose products are tracked. */
+	std::size_t _non_basis;
+	/** Smallest and largest allowed inner products for each basis vector. */
+	std::vector<double> _lo;
+	std::vector<double> _hi;
+	/**
+	 * Entry r is the largest value of the sum of squares of the first r
+	 * inner products.
+	 */
+	std::vector<double> _max_sq;
+	/** Minkowski norm of the nullspace vector. */
+	double _null_norm;
+	/** Slack allowed in each bound to cover rounding errors. */
+	double _margin;
+	/** Whether the bound on q(b) can be used. */
+	bool _check_norm;
+	/** Whether q(b) must be at least 1, rather than at most 1. */
+	bool _norm_above;
+	/** Whether the signs of the products with non-basis vectors are checked. */
+	bool _check_signs;
+	/** Required number of dotted edges, if restricted. */
+	DottedRange _dotted;
+	bool _check_dotted;
+	/** Whether the products with non-basis vectors must pass AngleCheck. */
+	bool _check_angles;
+	/** Inner products in Angles, sorted in increasing order. */
+	std::vector<double> _angles;
+	/**
+	 * Entry r is the number of the first r coordinates whose domain only
+	 * contains, or contains any, dotted products.
+	 */
+	std::vector<std::size_t> _always_dotted;
+	std::vector<std::size_t> _maybe_dotted;
+	/** Entry i is the number of dotted coordinates fixed from i onwards. */
+	std::vector<std::size_t> _fixed_dotted;
+	/** Inverse of the basis gram matrix. */
+	arma::mat _gram_inv;
+	/** Column j is G^-1 p for the jth non-basis vector. */
+	arma::mat _coeffs;
+	/** Products of the nullspace vector with each non-basis vector. */
+	arma::vec _null_products;
+	/**
+	 * Entry (j, r) is the smallest, or largest, value the first r coordinates
+	 * can contribute to the product with the jth non-basis vector.
+	 */
+	arma::mat _remaining_min;
+	arma::mat _remaining_max;
+	/**
+	 * Smallest and largest eigenvalues of the leading r x r block of G^-1,
+	 * indexed by r.
+	 */
+	arma::vec _eig_min;
+	arma::vec _eig_max;
+	/**
+	 * Column i holds the state when coordinates i onwards are fixed: G^-1 b
+	 * restricted to those coordinates, then b^T G^-1 b, then the products with
+	 * each non-basis vector. Column _size is the empty assignment.
+	 */
+	arma::mat _state;
+
+	/**
+	 * Whether some value in [lo, hi] would pass AngleCheck, as a dotted edge or
+	 * one of the inner products in Angles.
+	 */
+	bool
+	angle_between(double lo, double hi) const;
+};
+}
+#endif
@@ -0,0 +1,110 @@
+/*
+ * inner_product_symmetry.h
+ * Copyright 2015 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * Symmetry reduction of the inner product vectors which extend a candidate.
+ *
+ * A permutation s of the basis vectors which preserves the gram matrix, and
+ * fixes the products with every non-basis vector, is an isometry of the
+ * candidate. Extending by the inner products b and by b permuted by s then
+ * gives equivalent polytopes, so only one vector from each orbit is needed.
+ *
+ * The vector kept is the one of smallest rank, so is found by comparing
+ * entries from the last to the first. As the entries are fixed in that order,
+ * a subtree can be skipped as soon as some permutation is known to give a
+ * vector of smaller rank for every completion.
+ *
+ * Copies share the automorphisms found, and only copy the state of the
+ * comparisons, so one instance can be copied cheaply for each range of ranks.
+ */
+#pragma once
+#ifndef PTOPE_INNER_PRODUCT_SYMMETRY_H_
+#define PTOPE_INNER_PRODUCT_SYMMETRY_H_
+
+#include "polytope_candidate.h"
+
+#include <memory>
+#include <vector>
+
+namespace ptope {
+class InnerProductSymmetry {
+public:
+	/**
+	 * Compute the automorphisms of the candidate's basis. Large groups are
+	 * truncated to a fixed number of elements, which still gives at least one
+	 * vector from every orbit.
+	 */
+	InnerProductSymmetry(const PolytopeCandidate & candidate);
+	/**
+	 * Compute the automorphisms of the candidate's basis which also map each
+	 * basis vector to one with the same domain of inner products. Digits passed
+	 * to fix are then positions in that domain.
+	 */
+	InnerProductSymmetry(const PolytopeCandidate & candidate,
+			const std::vector<std::vector<double>> & domains);
+	/** Number of automorphisms found, including the identity. */
+	std::size_t
+	order() const {
+		return _n_perms + 1;
+	}
+	/**
+	 * Fix the entry at index to be the inner product with the given position in
+	 * the list of inner products. All entries after index must already be
+	 * fixed.
+	 */
+	void
+	fix(std::size_t index, std::size_t digit);
+	/**
+	 * Check whether some automorphism maps every completion of the entries
+	 * fixed from the given index onwards to a vector of smaller rank.
+	 */
+	bool
+	can_prune(std::size_t) const {
+		return _smaller;
+	}
+private:
+	/** Number of basis vectors. */
+	std::size_t _size;
+	/** Number of non-identity automorphisms. */
+	std::size_t _n_perms;
+	/**
+	 * Basis vectors with equal domains share a class, and automorphisms must
+	 * preserve the classes.
+	 */
+	std::vector<std::size_t> _classes;
+	/** Each block of _size entries is one non-identity automorphism. */
+	std::shared_ptr<const std::vector<std::size_t>> _perms;
+	/** The fixed entries. */
+	std::vector<std::size_t> _digits;
+	/**
+	 * Comparison state of each automorphism after the entries from index
+	 * onwards are fixed, stored in block index. Zero means the permuted vector
+	 * is never smaller, otherwise the entries above state - 1 are equal and
+	 * that entry is still to be compared.
+	 */
+	std::vector<std::size_t> _state;
+	/** Whether the last call to fix found a smaller permuted vector. */
+	bool _smaller;
+
+	void
+	init(const arma::mat & gram);
+	void
+	find_automorphisms(const arma::mat & gram, std::vector<std::size_t> & perms,
+			std::vector<std::size_t> & perm, std::vector<bool> & used,
+			std::size_t index);
+};
+}
+#endif
@@ -20,29 +20,261 @@
 
 #include "armadillo"
 
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <vector>
 
+#include "angles.h"
+#include "inner_product_bounds.h"
+#include "inner_product_symmetry.h"
+
 namespace ptope {
 class InnerProductVectors {
 public:
-	InnerProductVectors(int size);
+	/** Order in which the vectors are returned. */
+	enum class Order {
+		/** The first entry changes fastest, as in an odometer. */
+		Lexicographic,
+		/**
+		 * Reflected mixed-radix Gray code, where consecutive vectors differ in
+		 * exactly one entry.
+		 */
+		Gray
+	};
+	/**
+	 * Half-open range [begin, end) of ranks, where the rank of a vector is its
+	 * index in the full enumeration. Ranges can be used to split the vectors
+	 * into disjoint chunks to be handled separately, or to resume from a given
+	 * vector.
+	 */
+	struct Range {
+		std::size_t begin;
+		std::size_t end;
+		/** The range covering all vectors. */
+		Range()
+			:	begin(0),
+				end(std::numeric_limits<std::size_t>::max()) {}
+		Range(std::size_t b, std::size_t e)
+			:	begin(b),
+				end(e) {}
+	};
+	/**
+	 * Allowed inner products for each entry of the vectors. Each entry's
+	 * products are tried from largest to smallest.
+	 */
+	typedef InnerProductBounds::Domains Domains;
+	/**
+	 * Iterate over every vector of the given size whose entries are taken from
+	 * the allowed inner products.
+	 */
+	InnerProductVectors(int size, Order order = Order::Lexicographic);
+	/**
+	 * Iterate over the vectors with rank in the given range. The end of the
+	 * range is clamped to the total number of vectors.
+	 */
+	InnerProductVectors(int size, const Range & range,
+			Order order = Order::Lexicographic);
+	/**
+	 * Iterate over the vectors whose ith entry is taken from the ith domain,
+	 * with rank in the given range.
+	 */
+	InnerProductVectors(const Domains & domains, const Range & range = Range(),
+			Order order = Order::Lexicographic);
+	/**
+	 * Iterate over the vectors of inner products which could extend the given
+	 * candidate. Any subtree of vectors which cannot give a valid extension is
+	 * skipped, but otherwise the vectors are returned in the same order as the
+	 * full enumeration.
+	 */
+	InnerProductVectors(const PolytopeCandidate & candidate);
+	/**
+	 * Iterate over the vectors which could extend the given candidate with rank
+	 * in the given range.
+	 */
+	InnerProductVectors(const PolytopeCandidate & candidate,
+			const Range & range);
+	/**
+	 * As above, choosing whether to prune using the bounds in
+	 * InnerProductBounds, and whether to only return one vector from each orbit
+	 * under the symmetries of the candidate, as in InnerProductSymmetry.
+	 *
+	 * Symmetry reduction changes the vectors returned, so that the extensions
+	 * are only the same up to equivalence.
+	 */
+	InnerProductVectors(const PolytopeCandidate & candidate,
+			const Range & range, bool use_bounds, bool use_symmetry);
+	/**
+	 * As above, with the entries taken from the given domains rather than all
+	 * the allowed inner products. With use_bounds, subtrees whose extensions
+	 * cannot have a number of dotted edges in the given range are also skipped,
+	 * as are those which cannot pass AngleCheck if check_angles is set.
+	 *
+	 * In Gray code order the same subtrees are skipped, as each still covers a
+	 * block of consecutive ranks, so the same vectors are returned in a
+	 * different order.
+	 */
+	InnerProductVectors(const PolytopeCandidate & candidate,
+			const Domains & domains, const Range & range, bool use_bounds,
+			bool use_symmetry,
+			const InnerProductBounds::DottedRange & dotted =
+				InnerProductBounds::DottedRange(),
+			bool check_angles = false, Order order = Order::Lexicographic);
+	/**
+	 * Iterate over the same vectors as other, with rank in the given range.
+	 * The bounds and symmetries of other are copied rather than computed again,
+	 * so one enumeration can be cheaply split into many ranges. Other is only
+	 * read, so several threads can copy it at once.
+	 */
+	InnerProductVectors(const InnerProductVectors & other, const Range & range);
+	/**
+	 * Domains giving every entry all of the inner products in Angles.
+	 */
+	static
+	Domains
+	default_domains(std::size_t size);
+	/**
+	 * Domains where entry i may only meet the new vector at the angles pi/m for
+	 * m in labels[i].
+	 */
+	static
+	Domains
+	label_domains(const std::vector<Angles::PiSubmultiples> & labels);
+	/**
+	 * Domains where entry i may only meet the new vector at the angles pi/m for
+	 * which bit m of masks[i] is set.
+	 */
+	static
+	Domains
+	mask_domains(const std::vector<std::uint64_t> & masks);
 	bool
 	has_next();
 	const arma::vec &
 	next();
+	/**
+	 * Fill the columns of block with the next vectors, in the same order as
+	 * repeated calls to next() would give them. At most max_cols vectors are
+	 * added, fewer if the enumeration finishes first, and block is resized to
+	 * the number of columns actually filled. If ranks is given, it is filled
+	 * with the rank of each column.
+	 */
+	arma::uword
+	next_block(arma::mat & block, arma::uword max_cols,
+			std::vector<std::size_t> * ranks = nullptr);
+	/** Go back to the start of the range. */
 	void
 	reset();
+	/**
+	 * Rank of the vector which the next call to next() will return, or the end
+	 * of the range if there are none left.
+	 */
+	std::size_t
+	rank() const;
+	/**
+	 * Move so that the next call to next() returns the vector with the given
+	 * rank, or the first vector after it which is not pruned. Seeking beyond the
+	 * end of the range finishes the iteration.
+	 */
+	void
+	seek(std::size_t rank);
+	/** Total number of vectors in the full enumeration. */
+	std::size_t
+	total() const {
+		return _strides.back();
+	}
+	/**
+	 * Range of ranks of the chunk at index when the full enumeration is split
+	 * into n_chunks pieces of as even size as possible.
+	 */
+	Range
+	chunk(std::size_t index, std::size_t n_chunks) const;
+	/**
+	 * Number of subtrees of vectors which have been skipped since the last
+	 * reset, either by the bounds or by symmetry.
+	 */
+	std::size_t
+	pruned_subtrees() const {
+		return _pruned;
+	}
+	/**
+	 * Index of the single entry in which the vector last returned by next()
+	 * differs from the one before. Only meaningful in Gray code order, and
+	 * equal to the size of the vectors after the first call to next(), or when
+	 * skipping pruned vectors changed more than one entry.
+	 */
+	std::size_t
+	changed_index() const {
+		return _changed;
+	}
+	/**
+	 * Amount by which the entry at changed_index() changed in the vector last
+	 * returned by next().
+	 */
+	double
+	change() const {
+		return _change;
+	}
 private:
-	std::vector<double> _inner_products;
+	Domains _inner_products;
 	arma::vec _next;
 	std::vector<std::size_t> _progress;
-	std::size_t _progress_max;
+	/** Largest value of each entry of _progress. */
+	std::vector<std::size_t> _progress_max;
 	bool _has_next;
+	std::unique_ptr<InnerProductBounds> _bounds;
+	std::unique_ptr<InnerProductSymmetry> _symmetry;
+	std::size_t _pruned;
+	Order _order;
+	/** Direction each entry is moving in Gray code order. */
+	std::vector<bool> _ascending;
+	/** The change made by the last increment, for the vector to be returned. */
+	std::size_t _next_changed;
+	double _next_change;
+	/** The change reported for the vector last returned. */
+	std::size_t _changed;
+	double _change;
+	/** _strides[i] is the number of vectors in a subtree below entry i. */
+	std::vector<std::size_t> _strides;
+	std::size_t _rank;
+	std::size_t _begin;
+	std::size_t _end;
 
 	void
 	increment_progress();
+	/**
+	 * Move to the first vector of the subtree after the one containing the
+	 * current vector below index start, carrying into later entries as needed.
+	 * Returns the last index which was changed.
+	 */
+	std::size_t
+	increment_from(std::size_t start);
+	/** Move to the next vector in Gray code order. */
+	void
+	increment_gray();
+	void
+	init_range(const Range & range);
+	/**
+	 * Set the entries, and their directions in Gray code order, to those of
+	 * the vector with the given rank. Returns the last index which changed.
+	 */
+	std::size_t
+	set_progress(std::size_t rank);
+	/**
+	 * Move to the first vector in Gray code order after the subtree containing
+	 * the current vector below index start. Returns the last index which was
+	 * changed.
+	 */
+	std::size_t
+	skip_gray(std::size_t start);
+	/**
+	 * Move the progress counter on to the next vector which the bounds and
+	 * symmetries cannot rule out, given that entries from top onwards have
+	 * changed.
+	 */
+	void
+	skip_pruned(std::size_t top);
 	void
-	compute_next();
+	compute_next(double * out) const;
 };
 }
 #endif
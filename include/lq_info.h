@@ -30,9 +30,29 @@ namespace ptope {
 namespace detail {
 class LQInfo {
 public:
+	/**
+	 * Scratch memory needed to compute the decomposition. Each thread computing
+	 * decompositions needs its own workspace. Reusing the same one between calls
+	 * means the buffers are only allocated once.
+	 */
+	struct Workspace {
+		arma::mat li;
+		arma::mat orthog;
+		arma::podarray<double> work;
+		arma::podarray<double> tau;
+	};
+	/**
+	 * Compute the decomposition using a workspace local to the calling thread.
+	 */
 	static
 	std::unique_ptr<LQInfo>
 	compute(arma::mat const & m);
+	/**
+	 * Compute the decomposition using the provided workspace.
+	 */
+	static
+	std::unique_ptr<LQInfo>
+	compute(arma::mat const & m, Workspace & ws);
 	/** Get reference to Q**T * inv(L) matrix */
 	arma::mat const &
 	qtli() const;
@@ -21,32 +21,27 @@
  * A connected matrix is parabolic if it is positive semi-definite but not
  * positive definite. Equivalently all eigenvalues are non-negative, with at
  * least one being 0.
+ *
+ * Submatrices whose entries are all known angles are classified exactly from
+ * their Coxeter diagrams, while any others are checked numerically.
+ *
+ * Each submatrix is built from the connected component of its diagram which
+ * contains the last vector, together with vectors orthogonal to all of that
+ * component. The components are grown one connected vector at a time, so that
+ * an indefinite component rules out every submatrix containing it, and the
+ * orthogonal vectors are factored as a separate block.
  */
 #pragma once
 #ifndef PTOPE_PARABOLIC_CHECK_H_
 #define PTOPE_PARABOLIC_CHECK_H_
 
+#include "elliptic_classifier.h"
 #include "polytope_candidate.h"
 
+#include <vector>
+
 namespace ptope {
 class ParabolicCheck {
-private:
-	/**
-	 * Class to compute determinants (up to sign) which keeps cetain chunks of
-	 * memory allocated to prevent allocations each time a det is computed.
-	 */
-	class UnsignedDet {
-	public:
-		/**
-		 * Compute the determinant of a given matrix. This determinant will give a
-		 * correct absolute value, however the sign might be incorrect.
-		 */
-		double
-		operator()(const arma::mat & m);
-	private:
-		arma::podarray<arma::blas_int> _ipiv;
-		arma::mat _copy;
-	};
 public:
 	ParabolicCheck() {}
 	/**
@@ -60,25 +55,62 @@ public:
 	bool
 	operator()(const PolytopeCandidate & p);
 private:
-	arma::vec _evalues;
-	UnsignedDet _det;
-	arma::mat _submat_cache;
-	/** Checks whether given matrix is parabolic. */
+	/**
+	 * LDL^T factorisation of the submatrix on the current prefix of indices.
+	 * Column r holds row r of the unit lower triangular L above the diagonal,
+	 * and the pivot D_r on the diagonal.
+	 */
+	arma::mat _ldl;
+	/** Entries of L D for the row being added. */
+	arma::vec _scaled;
+	EllipticClassifier _classifier;
+	/** Indices of the submatrix passed to the classifier. */
+	std::vector<std::size_t> _class_indices;
+	/**
+	 * Entry k holds the vectors which can be added to a component of k
+	 * vectors while keeping it connected.
+	 */
+	std::vector<std::vector<arma::uword>> _extensions;
+	/**
+	 * Entry k holds the vectors orthogonal to every vector in a component of k
+	 * vectors.
+	 */
+	std::vector<std::vector<arma::uword>> _orthogonal;
+	/**
+	 * Extend the factorisation of the submatrix on the first row indices to
+	 * include indices(row). Returns false if the extended submatrix is not
+	 * positive semi-definite.
+	 *
+	 * The vectors before first must be orthogonal to the new vector, so that
+	 * the new row only depends on the block of the factorisation from first.
+	 */
+	bool
+	add_row(const arma::mat & m, const arma::uvec & indices, arma::uword row,
+			arma::uword first = 0);
+	/** Whether the factorised submatrix of the given size is singular. */
+	bool
+	singular(arma::uword size) const;
+	/**
+	 * Recursively grow the connected component on the first size indices,
+	 * checking all submatrices in which it is the component of the last vector.
+	 */
 	bool
-	parabolic(const arma::mat & m);
-	/** Recursively construct submatrices. */
+	check_connected(arma::uvec & indices, arma::uword size, const arma::mat & m);
+	/**
+	 * Recursively fill the rest of the submatrix with vectors orthogonal to the
+	 * component of the first size indices, taken from pool starting at position
+	 * start.
+	 */
 	bool
-	check_submatrices(arma::uvec & indices, arma::uword index,
+	check_orthogonal(arma::uvec & indices, arma::uword size, arma::uword index,
+			const std::vector<arma::uword> & pool, arma::uword start,
 			const arma::mat & m);
+	/** Check whether the complete, factorised submatrix is parabolic. */
+	bool
+	check_submatrix(const arma::uvec & indices);
 };
 inline
 bool
-ParabolicCheck::operator()(const arma::mat & m, const arma::uword & dim) {
-	arma::uvec ind(dim);
-	return check_submatrices(ind, 0, m);
-}
-inline
-bool
 ParabolicCheck::operator()(const PolytopeCandidate & p) {
 	return operator()(p.gram(), p.real_dimension());
 }
@@ -0,0 +1,100 @@
+/*
+ * parallel_extender.h
+ * Copyright 2015 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * Extend a polytope in every possible way using a pool of threads.
+ *
+ * The ranks of the inner product vectors are split recursively: a task for a
+ * large range submits the upper half as a new task and carries on with the
+ * lower half, until the range is small enough to run through a
+ * PolytopeExtender. As the rejection rate varies a lot across the ranges, the
+ * idle workers steal the pending halves from busy ones.
+ *
+ * Each extension found is passed to a sink. Calls to the sink are serialised,
+ * so it need not be thread safe, and can optionally be made in the same order
+ * as a serial PolytopeExtender would return them.
+ *
+ * The bounds and symmetries used to prune the enumeration only depend on the
+ * candidate, so they are computed once for each run and copied by every range.
+ */
+#pragma once
+#ifndef PTOPE_PARALLEL_EXTENDER_H_
+#define PTOPE_PARALLEL_EXTENDER_H_
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "polytope_extender.h"
+#include "thread_pool.h"
+
+namespace ptope {
+class ParallelExtender {
+public:
+	typedef std::function<void(const PolytopeCandidate &)> Sink;
+	struct Options {
+		/** Options used for the extender run on each range. */
+		PolytopeExtender::Options extender;
+		/** Ranges with at most this many vectors are not split further. */
+		std::size_t grain;
+		/** Pass the extensions to the sink in the serial order. */
+		bool ordered;
+		Options() : extender(), grain(4096), ordered(false) {}
+	};
+	ParallelExtender(const PolytopeCandidate & initial_polytope,
+			const Options & options = Options());
+	/**
+	 * Compute every extension using the threads in pool, passing each to sink.
+	 * Returns once all extensions have been passed to the sink.
+	 *
+	 * If the sink or an extension throws, no further ranges are started and
+	 * the exception is rethrown here once the running ones have finished.
+	 */
+	void
+	run(ThreadPool & pool, const Sink & sink);
+	/** Number of subtrees of inner product vectors skipped by pruning. */
+	std::size_t
+	pruned_subtrees() const {
+		return _pruned;
+	}
+private:
+	/** Extensions found in one range, waiting to be passed to the sink. */
+	struct Chunk {
+		std::size_t end;
+		std::vector<PolytopeCandidate> results;
+	};
+	PolytopeCandidate _initial;
+	Options _options;
+	std::atomic<std::size_t> _pruned;
+	/** Set once some range throws, so that no more ranges are started. */
+	std::atomic<bool> _failed;
+	/** Guards the sink and the chunks waiting for it. */
+	std::mutex _sink_mutex;
+	/** Chunks which finished out of order, keyed by the start of their range. */
+	std::map<std::size_t, Chunk> _waiting;
+	/** Start of the next range whose extensions should go to the sink. */
+	std::size_t _emit_from;
+
+	void
+	process(ThreadPool & pool, const Sink & sink,
+			const PolytopeExtender & prototype, std::size_t begin, std::size_t end);
+	void
+	deliver(const Sink & sink, std::size_t begin, Chunk && chunk);
+};
+}
+#endif
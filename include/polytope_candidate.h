@@ -18,8 +18,11 @@
  * Candidate to be a polytope. Contains both the gram matrix and the vectors
  * which make up the polytope.
  *
- * Warning: This class is *not* thread safe for use in shared memory
- * applications.
+ * Different candidates can be extended concurrently from different threads, as
+ * long as each thread uses its own Workspace (the overloads without a
+ * Workspace use one local to the calling thread). A single candidate should not
+ * be extended from two threads at once, as its LQ decomposition is computed
+ * lazily on first use.
  */
 #pragma once
 #ifndef PTOPE_POLYTOPE_CANDIDATE_H_
@@ -27,6 +30,8 @@
 
 #include <memory>
 
+#include <boost/dynamic_bitset.hpp>
+
 #include "lq_info.h"
 #include "vector_family.h"
 
@@ -35,6 +40,84 @@ class PolytopeCandidate {
 	static PolytopeCandidate InValid;
 public:
 	typedef arma::mat GramMatrix;
+	/**
+	 * Scratch memory used when extending a candidate. Keeping one of these per
+	 * thread means no allocations are needed for each extension.
+	 */
+	struct Workspace {
+		/** Vector constructed from the inner products. */
+		arma::vec new_vec;
+		/** Non-basis vectors with the sign of their last coordinate flipped. */
+		arma::mat batch_non_basis;
+		/** Products of the non-basis vectors with a batch of new vectors. */
+		arma::mat batch_products;
+		/** Products of the non-basis vectors with the nullspace vector. */
+		arma::vec batch_null_products;
+		/** Workspace used to compute LQ decompositions. */
+		detail::LQInfo::Workspace lq;
+		/** Get the workspace local to the calling thread. */
+		static
+		Workspace &
+		local();
+	};
+	/**
+	 * Constructs the new vectors for a sequence of inner product vectors in
+	 * which each differs from the last in a single entry, as given by the Gray
+	 * code order of InnerProductVectors.
+	 *
+	 * The unnormalised vector is linear in the inner products, so changing one
+	 * entry only adds a multiple of one column of the solution matrix. Its
+	 * Minkowski products with itself, the nullspace vector and the non-basis
+	 * vectors are updated in the same way, so each step costs O(d) rather than
+	 * the O(d^2) of a full matrix-vector product.
+	 *
+	 * All data needed is copied from the candidate on construction.
+	 */
+	class Incremental {
+	public:
+		Incremental() = default;
+		Incremental(const PolytopeCandidate & candidate);
+		/** Start again from the given inner products. */
+		void
+		reset(const arma::vec & inner_products);
+		/** Add delta to the inner product at index. */
+		void
+		update(arma::uword index, double delta);
+		/**
+		 * Compute the unit vector for the current inner products, returning false
+		 * if there is no valid vector. On success the vector is given by vector().
+		 */
+		bool
+		compute();
+		/** The vector found by the last successful call to compute(). */
+		const arma::vec &
+		vector() const {
+			return _new_vec;
+		}
+	private:
+		bool _hyperbolic;
+		/** Matrix taking inner products to the unnormalised vector. */
+		arma::mat _solution;
+		/** Products between the columns of _solution. */
+		arma::mat _solution_prods;
+		/** Products of the nullspace vector with the columns of _solution. */
+		arma::vec _null_prods;
+		/** Products of the non-basis vectors with the columns of _solution. */
+		arma::mat _non_basis_prods;
+		/** Products of the non-basis vectors with the nullspace vector. */
+		arma::vec _non_basis_null;
+		arma::vec _null;
+		double _null_norm;
+		/** Current unnormalised vector x. */
+		arma::vec _x;
+		/** Products of x with the columns of _solution. */
+		arma::vec _x_prods;
+		/** Products of x with the non-basis vectors. */
+		arma::vec _x_non_basis;
+		double _xx;
+		double _ax;
+		arma::vec _new_vec;
+	};
 	/**
 	 * Default constructor. No methods will work with an instance created using
 	 * this. Just here for compatability.
@@ -61,6 +144,16 @@ public:
 	PolytopeCandidate(const double * gram_ptr, int gram_size,
 			const double * vector_ptr, int vector_dim, int no_vectors);
 	PolytopeCandidate(std::initializer_list<std::initializer_list<double>> l);
+	/**
+	 * Replace this candidate by the hyperbolic candidate given by c-style
+	 * arrays, as in the constructor above, except that the columns of the gram
+	 * matrix start gram_ld entries apart. Memory is reused wherever the sizes
+	 * are unchanged, so repeatedly assigning candidates of the same size does
+	 * not allocate.
+	 */
+	void
+	assign(const double * gram_ptr, int gram_size, int gram_ld,
+			const double * vector_ptr, int vector_dim, int no_vectors);
 	/**
 	 * Given a vector of inner products with the basis vectors extend the
 	 * polytope to include the new hyperplane defined by this vector.
@@ -83,6 +176,31 @@ public:
 	bool
 	extend_by_inner_products(PolytopeCandidate & result,
 			const arma::vec & new_vector) const;
+	/**
+	 * As above, but using the provided workspace rather than the one local to the
+	 * calling thread.
+	 */
+	bool
+	extend_by_inner_products(PolytopeCandidate & result,
+			const arma::vec & new_vector, Workspace & ws) const;
+	/**
+	 * Compute the new vectors given by each column of inner products at once.
+	 *
+	 * On return ok[i] is set if column i of inner_products gives a valid vector,
+	 * in which case that vector is stored in column i of new_vectors. Only the
+	 * valid vectors then need to be passed to extend_by_vector.
+	 *
+	 * All candidate vectors are formed with a single matrix product, so this is
+	 * much cheaper than calling extend_by_inner_products for each column.
+	 *
+	 * Returns the number of valid vectors.
+	 */
+	std::size_t
+	extend_batch(const arma::mat & inner_products, boost::dynamic_bitset<> & ok,
+			arma::mat & new_vectors) const;
+	std::size_t
+	extend_batch(const arma::mat & inner_products, boost::dynamic_bitset<> & ok,
+			arma::mat & new_vectors, Workspace & ws) const;
 	/**
 	 * Extend the polytope by a given normal vector.
 	 */
@@ -95,6 +213,13 @@ public:
 	void
 	extend_by_vector(PolytopeCandidate & result, const arma::vec & new_vector)
 		const;
+	/**
+	 * Number of dotted edges, those with inner product below -1, which the
+	 * given normal vector would have with the existing vectors. This matches
+	 * the count made by NumberDottedCheck on the extended polytope.
+	 */
+	std::size_t
+	dotted_edges(const arma::vec & new_vector) const;
 	/**
 	 * Change the order of the vectors, so that a new basis consisting of those
 	 * vectors specified by the given vector is used. This then constructs a new
@@ -117,6 +242,18 @@ public:
 	valid() const {
 		return _valid;
 	}
+	/** Check whether the vectors have been extended into hyperbolic space. */
+	bool
+	hyperbolic() const {
+		return _hyperbolic;
+	}
+	/**
+	 * Get the vector spanning the nullspace of the basis vectors, that is the
+	 * direction Minkowski orthogonal to every basis vector. Only defined for
+	 * hyperbolic candidates.
+	 */
+	const arma::vec &
+	null_vector() const;
 	std::size_t
 	real_dimension() const;
 	/**
@@ -186,11 +323,13 @@ private:
 	mutable
 	std::unique_ptr<detail::LQInfo> _lq_info;
 	/**
-	 * Calculate the vector which gives the specified inner products.
+	 * Calculate the vector which gives the specified inner products, storing it
+	 * in ws.new_vec.
 	 * Returns true if the vector is valid, false if it is invalid.
 	 */
 	bool
-	vector_from_inner_products(const arma::vec & inner_vector) const;
+	vector_from_inner_products(const arma::vec & inner_vector, Workspace & ws)
+		const;
 };
 }
 #endif
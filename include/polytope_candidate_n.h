@@ -0,0 +1,124 @@
+/*
+ * polytope_candidate_n.h
+ * Copyright 2016 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * Hyperbolic polytope candidate of fixed dimension, stored inline with room
+ * for a fixed number of vectors.
+ *
+ * A PolytopeCandidate keeps its gram matrix and vectors on the heap, so every
+ * copy of one allocates. This holds the same gram matrix and vectors in arrays
+ * sized for MaxFacets vectors of dimension D + 1, so copying and extending
+ * never allocate, and extending in place only writes the new row and column of
+ * the gram matrix.
+ *
+ * Only hyperbolic candidates are stored, which includes every candidate after
+ * the first extension. These convert to and from PolytopeCandidate, and
+ * converting into an existing PolytopeCandidate of the same size reuses its
+ * memory.
+ */
+#pragma once
+#ifndef PTOPE_POLYTOPE_CANDIDATE_N_H_
+#define PTOPE_POLYTOPE_CANDIDATE_N_H_
+
+#include <array>
+
+#include "calc.h"
+#include "polytope_candidate.h"
+
+namespace ptope {
+template <std::size_t D, std::size_t MaxFacets>
+class PolytopeCandidateN {
+public:
+	/** Real dimension of the polytope. */
+	static constexpr std::size_t dimension = D;
+	/** Largest number of vectors which can be stored. */
+	static constexpr std::size_t max_facets = MaxFacets;
+	/** Number of coordinates of each vector. */
+	static constexpr std::size_t vector_size = D + 1;
+
+	/** Construct an invalid candidate with no vectors. */
+	PolytopeCandidateN() : _size(0), _valid(false) {}
+	/** Copy the given candidate, see assign. */
+	explicit
+	PolytopeCandidateN(const PolytopeCandidate & p) : _size(0), _valid(false) {
+		assign(p);
+	}
+	/* Only the vectors in use are copied. */
+	PolytopeCandidateN(const PolytopeCandidateN & p) : _size(0), _valid(false) {
+		*this = p;
+	}
+	PolytopeCandidateN &
+	operator=(const PolytopeCandidateN & p);
+	/**
+	 * Copy the given candidate. Returns false, leaving this candidate invalid,
+	 * if it is not a valid hyperbolic candidate of dimension D with at most
+	 * MaxFacets vectors.
+	 */
+	bool
+	assign(const PolytopeCandidate & p);
+	/** Copy this candidate into result, reusing its memory where possible. */
+	void
+	to_candidate(PolytopeCandidate & result) const;
+	/** Copy this candidate into a new PolytopeCandidate. */
+	PolytopeCandidate
+	to_candidate() const;
+	/**
+	 * Extend this candidate in place by the given normal vector. Returns false,
+	 * leaving the candidate unchanged, if there is no room for another vector
+	 * or the vector does not have vector_size entries.
+	 */
+	bool
+	extend_by_vector(const arma::vec & new_vector);
+	/**
+	 * Extend the polytope by the given normal vector, with the result in the
+	 * provided candidate. Returns false, leaving result unchanged, in the same
+	 * cases as above.
+	 */
+	bool
+	extend_by_vector(PolytopeCandidateN & result, const arma::vec & new_vector)
+		const;
+	bool
+	valid() const {
+		return _valid;
+	}
+	/** Number of vectors in the candidate. */
+	std::size_t
+	size() const {
+		return _size;
+	}
+	/** Entry (i, j) of the gram matrix. */
+	double
+	gram(std::size_t i, std::size_t j) const {
+		return _gram[j * MaxFacets + i];
+	}
+	/** Pointer to the vector_size coordinates of the i-th vector. */
+	const double *
+	vector_ptr(std::size_t i) const {
+		return _vectors.data() + i * vector_size;
+	}
+private:
+	/** Gram matrix, with each column starting MaxFacets entries apart. */
+	std::array<double, MaxFacets * MaxFacets> _gram;
+	/** Vectors stored one after another. */
+	std::array<double, vector_size * MaxFacets> _vectors;
+	std::size_t _size;
+	bool _valid;
+};
+
+#include "detail/polytope_candidate_n.inl"
+
+}
+#endif
@@ -18,17 +18,19 @@
 #ifndef PTOPE_POLYTOPE_CHECK_H_
 #define PTOPE_POLYTOPE_CHECK_H_
 
+#include "batch_cholesky.h"
+#include "block_diagonal_check.h"
 #include "comparator.h"
+#include "elliptic_classifier.h"
+#include "facet_mask.h"
 #include "polytope_candidate.h"
-#include "vector_set.h"
+#include "thread_pool.h"
 
 #include <algorithm>
+#include <deque>
 #include <queue>
-#include <set>
 #include <vector>
 
-#include "boost/pool/pool_alloc.hpp"
-
 namespace ptope {
 class PolytopeCheck {
 private:
@@ -37,14 +39,122 @@ public:
 	/**
 	 * Check whether a given polytope candidate is actually a compact polytope.
 	 * Returns true if it is a compact polytope.
+	 *
+	 * Candidates with more than max_facets vectors cannot be checked, and are
+	 * never considered compact.
 	 */
 	bool operator()(PolytopeCandidate const& p);
+	class State;
+	/**
+	 * Check the candidate as above, saving the vertices and edges found into
+	 * state so that candidates extending this one can be checked quickly.
+	 */
+	bool operator()(PolytopeCandidate const& p, State & state);
+	/**
+	 * Check a candidate which extends the candidate whose check saved parent
+	 * by a single vector, appended as the last row and column of its gram
+	 * matrix. Gives the same result as a full check.
+	 *
+	 * Every edge searched by the parent's check finds the same vertex, as the
+	 * new vector is the last to be tried. Only the edge on which the parent's
+	 * check failed needs to be compared against the new vector, before the
+	 * search carries on from the parent's remaining edges.
+	 *
+	 * The parent's state is only used if the gram matrix of the candidate it
+	 * was saved from is exactly the leading block of the gram matrix of p, so
+	 * that the facets are the same and in the same order. Otherwise, as for a
+	 * rebased candidate, a full check is run.
+	 */
+	bool check_extension(PolytopeCandidate const& p, State const& parent);
+	/** As above, also saving the state of this check. */
+	bool check_extension(PolytopeCandidate const& p, State const& parent,
+			State & state);
+	/** Largest number of vectors in a candidate which can be checked. */
+	static constexpr std::size_t max_facets = FacetMask<16>::max_facets;
+	/** Smallest number of waiting edges searched in parallel unless changed. */
+	static constexpr std::size_t default_min_batch = 128;
+	/**
+	 * Search the edges of large candidates using the threads in pool.
+	 *
+	 * Whenever at least min_batch edges are waiting to be searched, they are
+	 * all searched at once, split between the pool and the calling thread, and
+	 * the vertices found are then added in the same order as a serial search.
+	 * Small candidates never have that many edges waiting, so are checked
+	 * serially. A null pool turns the parallel search off. The pool must
+	 * outlive any check using it.
+	 *
+	 * Each check finds the same vertices and gives the same result as a serial
+	 * check, however edges found twice in the same batch are searched twice.
+	 */
+	void set_thread_pool(ThreadPool * pool,
+			std::size_t min_batch = default_min_batch);
+	/**
+	 * Set the margin used to screen batches of possible vertices in single
+	 * precision, see BatchCholesky::set_screen_margin. A margin of zero checks
+	 * every possible vertex in double precision.
+	 */
+	void set_screen_margin(float margin);
+	/**
+	 * Choose whether facets which are parallel or ultraparallel to one of an
+	 * edge's facets are skipped when searching along the edge. Such facets can
+	 * never give a vertex, so this only changes the work done, not the result.
+	 * The filter is on unless turned off.
+	 */
+	void set_adjacency_filter(bool filter);
+	/** Counts of the work done by the last check. */
+	struct Stats {
+		/** Number of vertices found. */
+		std::size_t vertices;
+		/** Number of edges searched for their second vertex. */
+		std::size_t edges_searched;
+		/**
+		 * Number of edge submatrices factored, one for each edge searched where
+		 * some possible vertex could not be classified from its labels.
+		 */
+		std::size_t potrf_calls;
+		/**
+		 * Number of edges skipped as both their vertices were already known,
+		 * each saving the search along the edge.
+		 */
+		std::size_t potrf_saved;
+		/** Number of possible vertices classified from their labels alone. */
+		std::size_t classified;
+		/** Number of possible vertices checked in single precision batches. */
+		std::size_t screened;
+		/**
+		 * Number of screened possible vertices which were too close to singular
+		 * to classify in single precision, so were checked again in double.
+		 */
+		std::size_t screen_ambiguous;
+		Stats()
+			: vertices(0), edges_searched(0), potrf_calls(0), potrf_saved(0),
+				classified(0), screened(0), screen_ambiguous(0) {}
+		Stats &
+		operator+=(const Stats & rhs) {
+			vertices += rhs.vertices;
+			edges_searched += rhs.edges_searched;
+			potrf_calls += rhs.potrf_calls;
+			potrf_saved += rhs.potrf_saved;
+			classified += rhs.classified;
+			screened += rhs.screened;
+			screen_ambiguous += rhs.screen_ambiguous;
+			return *this;
+		}
+	};
+	const Stats &
+	stats() const {
+		return _stats;
+	}
 private:
 	typedef uint_fast16_t vector_elem_t;
 	typedef arma::Col<vector_elem_t> vector_t;
 	typedef std::size_t vertex_index_t;
 	typedef uint_fast16_t vector_index_t;
 
+	/**
+	 * An edge is given by a vertex and the facet removed from it to leave the
+	 * facets containing the edge.
+	 */
 	struct Edge {
 		vertex_index_t vertex;
 		vector_index_t removed;
@@ -53,59 +163,167 @@ private:
 
 	static constexpr vector_elem_t no_vertex = std::numeric_limits<vector_elem_t>::max();
 
-	typedef boost::pool_allocator<Edge,
-		boost::default_user_allocator_new_delete,
-		boost::details::pool::null_mutex> EdgeAllocator;
-	typedef std::deque<Edge, EdgeAllocator> EdgeContainer;
+	// The queue uses the standard allocator, as the boost pool allocators share
+	// one pool between every queue, which would stop checks running concurrently.
+	typedef std::deque<Edge> EdgeContainer;
 	typedef std::queue<Edge, EdgeContainer> EdgeQueue;
 
-	VectorSet<vector_elem_t> _visited_vertices;
+	/*
+	 * Vertices and edges are stored as masks of the facets containing them.
+	 * The vertices found so far are kept, along with the edges known to have
+	 * both their vertices, so that each edge is only searched once.
+	 *
+	 * Two facets with inner product at most -1 are parallel or ultraparallel,
+	 * so cannot both contain a vertex. Entry i of adjacent is the mask of the
+	 * facets which could share a vertex with facet i.
+	 */
+	template <std::size_t Words>
+	struct Faces {
+		FacetMaskSet<Words> vertices;
+		FacetMaskSet<Words> closed_edges;
+		std::vector<FacetMask<Words>> adjacent;
+		/** Vertex found along each edge of a parallel batch. */
+		std::vector<FacetMask<Words>> batch_vertices;
+	};
+	/**
+	 * Scratch space used to search along edges. Each thread searching edges
+	 * has its own, so that checks can run concurrently.
+	 */
+	struct Workspace {
+		arma::mat edge_chol;
+		arma::vec schur_tmp;
+		/** Facets of the edge, ordered by component once it is factored. */
+		vector_t indices;
+		/** Facets of the possible vertex passed to the classifier. */
+		std::vector<std::size_t> vertex_indices;
+		/** Labels of the gram matrix being checked. */
+		EllipticClassifier classifier;
+		/** Splits edge submatrices into blocks before they are factored. */
+		BlockDiagonalCheck blocks;
+		/** Possible vertices which could not be classified, checked together. */
+		BatchCholesky batch;
+		/** Facets of the vertices added to the batch, with the candidate last. */
+		std::vector<std::size_t> batch_indices;
+		/** Candidate facet of each vertex in the batch. */
+		std::vector<vector_elem_t> batch_facets;
+		/** Work done by this thread in the current check. */
+		Stats stats;
+	};
+	/*
+	 * The width of the masks is the smallest which fits the number of vectors
+	 * in the candidate, and each set keeps its memory between checks.
+	 */
+	Faces<1> _faces_1;
+	Faces<2> _faces_2;
+	Faces<4> _faces_4;
+	Faces<16> _faces_16;
 	EdgeQueue _edge_queue;
+	/** Workspace used by the thread running the check. */
+	Workspace _workspace;
+	ThreadPool * _pool;
+	std::size_t _min_batch;
+	float _screen_margin;
+	bool _adjacency_filter;
+	/** Workspace for each thread in the pool. */
+	std::vector<Workspace> _workers;
+	/** Whether the workers have the labels of the gram matrix being checked. */
+	bool _workers_ready;
+	/** Edges being searched in parallel, and the facet found along each. */
+	std::vector<Edge> _batch;
+	std::vector<vector_elem_t> _batch_ends;
 	vector_index_t m_dimension;
+	Stats _stats;
+	/**
+	 * Pick the width of facet masks to use and run the check, starting from
+	 * parent and saving to state if they are given.
+	 */
+	bool priv_dispatch(PolytopeCandidate const& p, State const* parent,
+			State * state);
+	/**
+	 * Run the breadth first search over the vertices, using the provided sets
+	 * to hold the faces found.
+	 */
+	template <std::size_t Words>
+	bool priv_check(PolytopeCandidate const& p, Faces<Words>& faces,
+			State const* parent, State * state);
+	/**
+	 * Search every edge waiting in the queue using the thread pool, then add
+	 * the vertices found in queue order. Returns false if some edge has no
+	 * second vertex, in which case that edge and any after it in the batch are
+	 * saved to state.
+	 */
+	template <std::size_t Words>
+	bool priv_search_batch(arma::mat const& gram, Faces<Words>& faces,
+			State * state);
+	/** Search the edges in [begin, end) of the batch using ws. */
+	template <std::size_t Words>
+	void priv_search_chunk(Workspace & ws, arma::mat const& gram,
+			Faces<Words>& faces, std::size_t begin, std::size_t end);
 	/**
 	 * Find the vertex at the end of an edge. Each edge is constructed from an
 	 * initial vertex, so this finds the other vertex along the edge.
 	 *
 	 * Such a vertex is not guaranteed to exist. In fact if no such vertex can be
 	 * found then the provided gram matrix is not a hyperbolic polytope. In this
-	 * case the function returns false.
+	 * case the function returns no_vertex.
 	 *
-	 * If a vertex is found, then it is copied into the provided vector and true
-	 * is returned.
+	 * If a vertex is found, then it is copied into the provided mask and the
+	 * facet added to the edge to get the vertex is returned.
+	 *
+	 * Only facets from first_facet onwards which could share a vertex with
+	 * every facet of the edge are checked. Each possible vertex is first
+	 * classified from the labels of its diagram, and only checked numerically if
+	 * some label is unknown.
+	 *
+	 * The faces are only read, and all scratch space comes from ws, so edges
+	 * can be searched by several threads at once.
 	 */
+	template <std::size_t Words>
 	vector_elem_t priv_edge_end( Edge const& edge, arma::mat const& gram,
-			vector_t& vertex_out ) const;
+			Faces<Words> const& faces, FacetMask<Words>& vertex_out,
+			vector_index_t first_facet, Workspace & ws ) const;
 	/**
 	 * Find an initial elliptic subdiagram to use as initial vertex.
 	 */
-	void initial_vertex(PolytopeCandidate const& p, vector_t& output) const;
+	template <std::size_t Words>
+	void initial_vertex(PolytopeCandidate const& p, FacetMask<Words>& output)
+		const;
 	/**
 	 * Use the provided vertes to add all edges adjacent to that vertex to the
 	 * queue, except for the edge specified by the excluded index. The excluded
 	 * index corresponds to the edge which first visited this vertex.
 	 */
+	template <std::size_t Words>
 	void
-	add_edges_from_vertex(vector_t const& vertex, vertex_index_t const vertex_ind,
-			vector_elem_t const exclude);
-	/**
-	 * Construct the vector representing the vertex which lies at the end of the
-	 * specified edge with the given additional index.
-	 *
-	 * The vector is constructed in the provided output vector. Ensure that the
-	 * vector passed in has at least m_dimension elements. No size checking is
-	 * done.
-	 */
-	void priv_vertex_from_edge(Edge const& cur_edge,
-			vector_elem_t const vertex_index, vector_t& output) const;
+	add_edges_from_vertex(FacetMask<Words> const& vertex,
+			vertex_index_t const vertex_ind, vector_elem_t const exclude);
 	/**
 	 * Check whether the given matrix is elliptic (i.e. positive definite).
 	 */
-	bool is_elliptic(arma::mat const& mat) const;
+	bool is_elliptic(arma::mat const& mat);
 	/**
 	 * Check whether the given matrix has a cholesky decomposition.
 	 */
 	bool priv_has_chol(arma::mat const& mat, arma::blas_int nrows,
-		arma::blas_int ldmat) const;
+		arma::blas_int ldmat);
+	/**
+	 * Replace the upper triangle of the size x size diagonal block of the given
+	 * symmetric matrix starting at (start, start) by its cholesky factor U,
+	 * where block = U^T U. Returns false if the block is not positive definite.
+	 *
+	 * Blocks small enough to come from a polytope of dimension at most 10 are
+	 * factored by a kernel instantiated for their size, picked from a table.
+	 */
+	bool priv_chol_in_place(arma::mat & mat, arma::uword start,
+			arma::uword size) const;
+	/**
+	 * Check whether adding the column col, with diagonal entry diag, to the
+	 * matrix with cholesky factor chol gives a positive definite matrix. The
+	 * contents of col are overwritten. As above, small factors use a kernel
+	 * instantiated for their size.
+	 */
+	bool priv_schur_positive(arma::mat const& chol, double * col, double diag)
+		const;
 	/**
 	 * Copy the first num elements indexed by the indices vector from source_ptr
 	 * to col_ptr.
@@ -122,15 +340,53 @@ private:
 			vector_index_t ldsource) const;
 };
 
-inline
-void
-PolytopeCheck::add_edges_from_vertex( vector_t const& vertex,
-		vertex_index_t const vertex_ind, vector_elem_t const exclude) {
-	for(vector_index_t i = 0, max = m_dimension; i < max; ++i) {
-		if(vertex[i] == exclude) { continue; }
-		_edge_queue.emplace( vertex_ind, i );
+/**
+ * Vertices and edges found by a check, along with the edges still to be
+ * searched when the check stopped. The facet masks are stored at the largest
+ * width, so that the state can be used whatever the size of the extension.
+ */
+class PolytopeCheck::State {
+public:
+	State()
+		: _valid(false), _compact(false), _n_facets(0), _dimension(0), _gram(),
+			_vertices(), _closed_edges(), _edges() {}
+	/** Whether the check which saved this state found a compact polytope. */
+	bool
+	compact() const {
+		return _valid && _compact;
 	}
-}
+	/** Number of vertices found by the check. */
+	std::size_t
+	vertices() const {
+		return _vertices.size();
+	}
+private:
+	friend class PolytopeCheck;
+	typedef FacetMask<16> Mask;
+
+	/** Whether a search was run and saved. */
+	bool _valid;
+	bool _compact;
+	std::size_t _n_facets;
+	vector_index_t _dimension;
+	/** Gram matrix of the candidate checked. */
+	arma::mat _gram;
+	/** Vertices in the order they were found, so edges can refer to them. */
+	std::vector<Mask> _vertices;
+	std::vector<Mask> _closed_edges;
+	/**
+	 * Edges still to be searched. If the check failed then the first edge is
+	 * the one on which no vertex was found.
+	 */
+	std::vector<Edge> _edges;
+
+	/**
+	 * Whether the candidate with the given gram matrix and dimension extends
+	 * the one checked by a single vector, so that this state can be reused.
+	 */
+	bool
+	extended_by(arma::mat const& gram, vector_index_t dimension) const;
+};
 /*
  * A matrix is positive definite iff all its eigen values are positive. However
  * finding the eigenvalues of a matrix is computationally hard. Equivalently
@@ -147,7 +403,7 @@ PolytopeCheck::add_edges_from_vertex( vector_t const& vertex,
  */
 inline
 bool
-PolytopeCheck::is_elliptic(arma::mat const& mat) const {
+PolytopeCheck::is_elliptic(arma::mat const& mat) {
 	return priv_has_chol(mat, mat.n_rows, mat.n_cols);
 }
 // It might help to unroll this loop, but I'm not sure.
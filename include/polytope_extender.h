@@ -25,14 +25,82 @@
 #ifndef PTOPE_POLYTOPE_EXTENDER_H_
 #define PTOPE_POLYTOPE_EXTENDER_H_
 
+#include "angle_check.h"
 #include "polytope_candidate.h"
 #include "inner_product_vectors.h"
 
+#include <boost/dynamic_bitset.hpp>
+
 namespace ptope {
 class PolytopeExtender {
 public:
-	PolytopeExtender(const PolytopeCandidate & initial_polytope);
-	PolytopeExtender(PolytopeCandidate && initial_polytope);
+	/** Options controlling how the extensions are enumerated. */
+	struct Options {
+		/**
+		 * Skip any subtree of inner product vectors which cannot give a valid
+		 * extension. The extensions found are the same either way.
+		 */
+		bool prune;
+		/**
+		 * Enumerate the inner products in Gray code order, so that each new
+		 * vector can be found by a cheap update of the last one. This gives the
+		 * same extensions in a different order. Pruning and symmetry skip the
+		 * same subtrees in either order.
+		 */
+		bool gray_code;
+		/**
+		 * Only try one inner product vector from each orbit under the
+		 * automorphisms of the candidate. Every extension skipped is equivalent
+		 * to one which is returned, up to permuting the vectors.
+		 */
+		bool symmetry;
+		/**
+		 * Only use the inner product vectors with rank in this range. Disjoint
+		 * ranges give disjoint sets of extensions, so the work for one candidate
+		 * can be split between threads or processes.
+		 */
+		InnerProductVectors::Range range;
+		/**
+		 * Allowed inner products with each basis vector of the candidate. Left
+		 * empty, every basis vector uses all the inner products in Angles.
+		 */
+		InnerProductVectors::Domains domains;
+		/**
+		 * Only return extensions whose new vector has this many dotted edges.
+		 * With prune set, subtrees which cannot meet this are skipped during
+		 * the enumeration, otherwise each extension is checked as it is built.
+		 */
+		InnerProductBounds::DottedRange dotted;
+		/**
+		 * Only return extensions which pass AngleCheck, so the new vector has
+		 * one of the angles in Angles or a dotted edge with every existing
+		 * vector. With prune set, subtrees in which some product cannot be one
+		 * of these are skipped during the enumeration, and each extension is
+		 * still checked as it is built.
+		 */
+		bool angles;
+		Options()
+			:	prune(true),
+				gray_code(false),
+				symmetry(false),
+				range(),
+				domains(),
+				dotted(),
+				angles(false) {}
+	};
+	PolytopeExtender(const PolytopeCandidate & initial_polytope,
+			const Options & options = Options());
+	PolytopeExtender(PolytopeCandidate && initial_polytope,
+			const Options & options = Options());
+	/**
+	 * Extend the same candidate as other, with the same options, but only
+	 * using the inner product vectors with rank in the given range. The bounds
+	 * and symmetries used to prune the enumeration are copied from other rather
+	 * than computed again. Other is only read, so several threads can copy it
+	 * at once.
+	 */
+	PolytopeExtender(const PolytopeExtender & other,
+			const InnerProductVectors::Range & range);
 	/**
 	 * Check whether a subsequent call to next() will return a valid polytope.
 	 */
@@ -43,14 +111,56 @@ public:
 	 */
 	const PolytopeCandidate &
 	next();
+	/**
+	 * Number of subtrees of inner product vectors skipped so far by pruning.
+	 */
+	std::size_t
+	pruned_subtrees() const {
+		return _inner_product_vectors.pruned_subtrees();
+	}
+	/**
+	 * Rank of the inner product vector from which to restart, using
+	 * Options::range, so as to get exactly the extensions after the one last
+	 * returned by next().
+	 */
+	std::size_t
+	resume_rank() const {
+		return _resume_rank;
+	}
 private:
 	PolytopeCandidate _initial;
 	InnerProductVectors _inner_product_vectors;
 	PolytopeCandidate _next;
 	bool _computed_next;
+	/* Inner products are pulled from the iterator in blocks and extended with a
+	 * single call to PolytopeCandidate::extend_batch. */
+	arma::mat _batch_products;
+	arma::mat _batch_vectors;
+	std::vector<std::size_t> _batch_ranks;
+	boost::dynamic_bitset<> _batch_valid;
+	boost::dynamic_bitset<>::size_type _batch_pos;
+	/* In Gray code order the vectors are instead updated one step at a time. */
+	bool _gray_code;
+	PolytopeCandidate::Incremental _incremental;
+	std::size_t _gray_steps;
+	/* Inner products of the last vector, to update from after pruning. */
+	arma::vec _gray_last;
+	/* Extensions with a number of dotted edges outside this are skipped. */
+	InnerProductBounds::DottedRange _dotted;
+	/* Whether extensions failing AngleCheck are skipped. */
+	bool _angles;
+	AngleCheck _angle_check;
+	/* Rank to resume from after the extension in _next, and after the last one
+	 * returned. */
+	std::size_t _next_rank;
+	std::size_t _resume_rank;
 
 	bool
 	compute_next();
+	bool
+	fill_batch();
+	bool
+	compute_next_gray();
 };
 }
 #endif
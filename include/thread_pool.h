@@ -0,0 +1,102 @@
+/*
+ * thread_pool.h
+ * Copyright 2015 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * Fixed size pool of worker threads with work stealing.
+ *
+ * Each worker has its own double ended queue of tasks. Tasks submitted from a
+ * worker go on the back of that worker's queue, and the worker takes tasks from
+ * the back, so recently split work stays on the same thread. An idle worker
+ * steals from the front of the other queues, which holds the oldest and so
+ * typically largest pieces of work.
+ */
+#pragma once
+#ifndef PTOPE_THREAD_POOL_H_
+#define PTOPE_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ptope {
+class ThreadPool {
+public:
+	/** Tasks are passed the index of the worker running them. */
+	typedef std::function<void(std::size_t)> Task;
+	/**
+	 * Start a pool with the given number of worker threads. If this is zero then
+	 * one thread per hardware thread is used.
+	 */
+	explicit ThreadPool(std::size_t n_threads = 0);
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &
+	operator=(const ThreadPool &) = delete;
+	/** Finish any outstanding tasks and stop the workers. */
+	~ThreadPool();
+	/** Number of worker threads. */
+	std::size_t
+	size() const {
+		return _threads.size();
+	}
+	/**
+	 * Queue a task to be run. Tasks may themselves submit further tasks.
+	 */
+	void
+	submit(Task task);
+	/**
+	 * Block until every submitted task, including those submitted by other
+	 * tasks, has finished. Must not be called from within a task.
+	 *
+	 * If any task threw an exception then the first one thrown is rethrown
+	 * here, once every task has finished. The others are dropped.
+	 */
+	void
+	wait();
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+	std::vector<std::unique_ptr<Queue>> _queues;
+	std::vector<std::thread> _threads;
+	/** Guards the counts below, and is used with both condition variables. */
+	std::mutex _mutex;
+	std::condition_variable _work_cv;
+	std::condition_variable _done_cv;
+	/** Tasks submitted but not yet finished. */
+	std::size_t _pending;
+	/** Tasks submitted but not yet taken by a worker. */
+	std::size_t _queued;
+	bool _stop;
+	/** First exception thrown by a task since the last wait. */
+	std::exception_ptr _error;
+	/** Queue used for the next task submitted from outside the pool. */
+	std::atomic<std::size_t> _next_queue;
+
+	/** Take a task from the worker's own queue, or steal one from another. */
+	bool
+	pop(std::size_t worker, Task & task);
+	void
+	run(std::size_t worker);
+};
+}
+#endif
@@ -35,6 +35,12 @@ class VectorFamily {
 		 * number of vector_dim dimensional vectors.
 		 */
 		VectorFamily(const double * vector_ptr, int vector_dim, int no_vectors);
+		/**
+		 * Replace the vectors by those in the given c-style array, as in the
+		 * constructor above. The memory is reused if the size is unchanged.
+		 */
+		void
+		assign(const double * vector_ptr, int vector_dim, int no_vectors);
 		/**
 		 * Add a vector the family. The vector is assumed to be the same size as all
 		 * others in the family.
@@ -0,0 +1,339 @@
+/*
+ * batch_cholesky.cc
+ * Copyright 2016 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "batch_cholesky.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ptope {
+namespace {
+/** Results of the single precision screen for each lane. */
+enum : unsigned char { screen_positive, screen_negative, screen_ambiguous };
+}
+constexpr std::size_t BatchCholesky::lanes;
+constexpr std::size_t BatchCholesky::screen_lanes;
+constexpr float BatchCholesky::default_screen_margin;
+
+BatchCholesky::BatchCholesky()
+	:	_size(0),
+		_shared(0),
+		_chol(nullptr),
+		_ld(0),
+		_offsets(),
+		_group_size(0),
+		_data(),
+		_positive(),
+		_count(0),
+		_margin(default_screen_margin),
+		_screened(0),
+		_ambiguous(0),
+		_screen_data(),
+		_screen_chol(),
+		_screen_chol_ready(false),
+		_shared_pivot(1) {}
+void
+BatchCholesky::reset(std::size_t size) {
+	_size = size;
+	_shared = 0;
+	_chol = nullptr;
+	_ld = 0;
+	_offsets.resize(size);
+	_group_size = 0;
+	for(std::size_t j = 0; j < size; ++j) {
+		_offsets[j] = _group_size;
+		_group_size += j + 1;
+	}
+	_group_size *= lanes;
+	_screen_chol_ready = false;
+	clear();
+}
+void
+BatchCholesky::reset(std::size_t size, const arma::mat & chol,
+		std::size_t shared) {
+	_size = size;
+	_shared = shared;
+	_chol = chol.memptr();
+	_ld = chol.n_rows;
+	_offsets.resize(size);
+	_group_size = 0;
+	for(std::size_t j = shared; j < size; ++j) {
+		_offsets[j] = _group_size;
+		_group_size += j + 1;
+	}
+	_group_size *= lanes;
+	_screen_chol_ready = false;
+	clear();
+}
+void
+BatchCholesky::clear() {
+	_count = 0;
+}
+void
+BatchCholesky::add(const double * mat, std::size_t ld) {
+	prepare_next();
+	for(std::size_t j = _shared; j < _size; ++j) {
+		const double * col = mat + j * ld;
+		for(std::size_t i = 0; i <= j; ++i) {
+			next_entry(i, j) = col[i];
+		}
+	}
+	++_count;
+}
+/*
+ * The storage is kept between batches and only ever grows. Lanes which do not
+ * hold a matrix are never read, so the storage is not cleared.
+ */
+void
+BatchCholesky::prepare_next() {
+	const std::size_t needed = (_count / lanes + 1) * _group_size;
+	if(_data.size() < needed) {
+		_data.resize(needed);
+	}
+}
+/*
+ * Each pair of groups is screened at once in single precision. A group is
+ * only factored in double precision if the screen left some of its matrices
+ * undecided, and then only the results for those matrices are replaced.
+ */
+void
+BatchCholesky::run() {
+	const std::size_t n_groups = (_count + lanes - 1) / lanes;
+	if(_positive.size() < n_groups * lanes) {
+		_positive.resize(n_groups * lanes);
+	}
+	std::fill(_positive.begin(), _positive.begin() + _count, 1);
+	_screened = 0;
+	_ambiguous = 0;
+	if(_margin <= 0) {
+		for(std::size_t g = 0; g < n_groups; ++g) {
+			factor_group(_data.data() + g * _group_size, _positive.data() + g * lanes,
+					std::min(lanes, _count - g * lanes));
+		}
+		return;
+	}
+	for(std::size_t g = 0; g < n_groups; g += 2) {
+		if(_count - g * lanes < screen_lanes) {
+			// Screening a partial pair costs more than factoring it.
+			for(std::size_t h = g; h < n_groups; ++h) {
+				factor_group(_data.data() + h * _group_size, _positive.data() + h * lanes,
+						std::min(lanes, _count - h * lanes));
+			}
+			break;
+		}
+		screen_groups(g, screen_lanes);
+		_screened += screen_lanes;
+		for(std::size_t h = g; h < g + 2 && h < n_groups; ++h) {
+			const unsigned char * screen = _screen + (h - g) * lanes;
+			const std::size_t used = std::min(lanes, _count - h * lanes);
+			std::size_t n_ambiguous = 0;
+			for(std::size_t l = 0; l < used; ++l) {
+				n_ambiguous += (screen[l] == screen_ambiguous);
+			}
+			if(n_ambiguous == 0) {
+				continue;
+			}
+			_ambiguous += n_ambiguous;
+			unsigned char exact[lanes];
+			std::fill(exact, exact + lanes, 1);
+			factor_group(_data.data() + h * _group_size, exact, used);
+			for(std::size_t l = 0; l < used; ++l) {
+				if(screen[l] == screen_ambiguous) {
+					_positive[h * lanes + l] = exact[l];
+				}
+			}
+		}
+	}
+}
+void
+BatchCholesky::factor_group(double * data, unsigned char * positive,
+		std::size_t used) const {
+	// Fixing the number of lanes used lets each loop over them be unrolled,
+	// which matters most for the small groups which are common in practice.
+	switch(used) {
+		case 1: factor_group<1>(data, positive); break;
+		case 2: factor_group<2>(data, positive); break;
+		case 3: factor_group<3>(data, positive); break;
+		case 4: factor_group<4>(data, positive); break;
+		case 5: factor_group<5>(data, positive); break;
+		case 6: factor_group<6>(data, positive); break;
+		case 7: factor_group<7>(data, positive); break;
+		default: factor_group<8>(data, positive); break;
+	}
+}
+/*
+ * The same decomposition as factor_group, run in single precision on every
+ * lane, with the unused lanes holding the identity. Each pivot is compared
+ * against the margin scaled by the smallest relative pivot so far, as in
+ * set_screen_margin, and once a pivot has decided a lane or left it ambiguous,
+ * its later pivots are ignored.
+ *
+ * The relative pivots of the shared factor are those of the factorisation
+ * which gave it, as entry (j, j) of the shared block is the sum of squares of
+ * column j of its factor.
+ */
+void
+BatchCholesky::screen_groups(std::size_t first, std::size_t used) {
+	if(_shared > 0 && !_screen_chol_ready) {
+		_screen_chol.resize(_shared * _shared);
+		_shared_pivot = 1;
+		for(std::size_t j = 0; j < _shared; ++j) {
+			double sq_norm = 0;
+			for(std::size_t i = 0; i < j; ++i) {
+				sq_norm += _chol[j * _ld + i] * _chol[j * _ld + i];
+			}
+			const double pivot = _chol[j * _ld + j] * _chol[j * _ld + j];
+			_shared_pivot = std::min(_shared_pivot,
+					static_cast<float>(pivot / (pivot + 2 * sq_norm)));
+			for(std::size_t i = 0; i <= j; ++i) {
+				_screen_chol[j * _shared + i] = static_cast<float>(_chol[j * _ld + i]);
+			}
+		}
+		_screen_chol_ready = true;
+	} else if(_shared == 0) {
+		_shared_pivot = 1;
+	}
+	_screen_data.resize((_group_size / lanes) * screen_lanes);
+	float * data = _screen_data.data();
+	for(std::size_t j = _shared; j < _size; ++j) {
+		for(std::size_t i = 0; i <= j; ++i) {
+			const std::size_t entry = _offsets[j] + i;
+			float * dest = data + entry * screen_lanes;
+			for(std::size_t l = 0; l < screen_lanes; ++l) {
+				dest[l] = (l < used)
+					? static_cast<float>(_data[(first + l / lanes) * _group_size
+							+ entry * lanes + l % lanes])
+					: (i == j ? 1.0f : 0.0f);
+			}
+		}
+	}
+	std::fill(_screen, _screen + screen_lanes, screen_positive);
+	float min_pivot[screen_lanes];
+	std::fill(min_pivot, min_pivot + screen_lanes, _shared_pivot);
+	for(std::size_t j = _shared; j < _size; ++j) {
+		float * col_j = data + _offsets[j] * screen_lanes;
+		for(std::size_t i = 0; i < j; ++i) {
+			float dot[screen_lanes] = {};
+			float * entry = col_j + i * screen_lanes;
+			if(i < _shared) {
+				const float * u_i = _screen_chol.data() + i * _shared;
+				for(std::size_t k = 0; k < i; ++k) {
+					for(std::size_t l = 0; l < screen_lanes; ++l) {
+						dot[l] += u_i[k] * col_j[k * screen_lanes + l];
+					}
+				}
+				const float inv = 1.0f / u_i[i];
+				for(std::size_t l = 0; l < screen_lanes; ++l) {
+					entry[l] = (entry[l] - dot[l]) * inv;
+				}
+			} else {
+				const float * col_i = data + _offsets[i] * screen_lanes;
+				for(std::size_t k = 0; k < i; ++k) {
+					for(std::size_t l = 0; l < screen_lanes; ++l) {
+						dot[l] += col_i[k * screen_lanes + l] * col_j[k * screen_lanes + l];
+					}
+				}
+				const float * diag_i = col_i + i * screen_lanes;
+				for(std::size_t l = 0; l < screen_lanes; ++l) {
+					entry[l] = (entry[l] - dot[l]) * (1.0f / diag_i[l]);
+				}
+			}
+		}
+		float sq_norm[screen_lanes] = {};
+		for(std::size_t k = 0; k < j; ++k) {
+			for(std::size_t l = 0; l < screen_lanes; ++l) {
+				sq_norm[l] += col_j[k * screen_lanes + l] * col_j[k * screen_lanes + l];
+			}
+		}
+		float * diag = col_j + j * screen_lanes;
+		for(std::size_t l = 0; l < screen_lanes; ++l) {
+			const float pivot = diag[l] - sq_norm[l];
+			const float total = diag[l] + sq_norm[l];
+			const float bound = _margin * total;
+			const float scaled = pivot * min_pivot[l];
+			const unsigned char result = scaled > bound ? screen_positive
+				: (scaled < -bound ? screen_negative : screen_ambiguous);
+			_screen[l] = (_screen[l] == screen_positive) ? result : _screen[l];
+			diag[l] = scaled > bound ? std::sqrt(pivot) : 1.0f;
+			min_pivot[l] = scaled > bound
+				? std::min(min_pivot[l], pivot / total) : min_pivot[l];
+		}
+	}
+	for(std::size_t l = 0; l < used; ++l) {
+		_positive[first * lanes + l] = (_screen[l] == screen_positive);
+	}
+}
+/*
+ * Each column j of U is found from column j of the matrix by solving
+ * U_j^T u = a against the first j columns of U, which gives the entries above
+ * the diagonal, and the diagonal entry is then the square root of
+ * a_jj - u^T u. The matrix is positive definite iff every such value is
+ * positive.
+ *
+ * The columns in the shared block are the same for every lane, so are read
+ * from the shared factor. The operations follow the order used by potrf, so
+ * that borderline matrices are classified in the same way as a single
+ * factorisation would.
+ */
+template <std::size_t Used>
+void
+BatchCholesky::factor_group(double * data, unsigned char * positive) const {
+	for(std::size_t j = _shared; j < _size; ++j) {
+		double * col_j = data + _offsets[j] * lanes;
+		for(std::size_t i = 0; i < j; ++i) {
+			double dot[Used] = {};
+			double * entry = col_j + i * lanes;
+			if(i < _shared) {
+				const double * u_i = _chol + i * _ld;
+				for(std::size_t k = 0; k < i; ++k) {
+					for(std::size_t l = 0; l < Used; ++l) {
+						dot[l] += u_i[k] * col_j[k * lanes + l];
+					}
+				}
+				const double inv = 1.0 / u_i[i];
+				for(std::size_t l = 0; l < Used; ++l) {
+					entry[l] = (entry[l] - dot[l]) * inv;
+				}
+			} else {
+				const double * col_i = data + _offsets[i] * lanes;
+				for(std::size_t k = 0; k < i; ++k) {
+					for(std::size_t l = 0; l < Used; ++l) {
+						dot[l] += col_i[k * lanes + l] * col_j[k * lanes + l];
+					}
+				}
+				const double * diag_i = col_i + i * lanes;
+				for(std::size_t l = 0; l < Used; ++l) {
+					entry[l] = (entry[l] - dot[l]) * (1.0 / diag_i[l]);
+				}
+			}
+		}
+		double sq_norm[Used] = {};
+		for(std::size_t k = 0; k < j; ++k) {
+			for(std::size_t l = 0; l < Used; ++l) {
+				sq_norm[l] += col_j[k * lanes + l] * col_j[k * lanes + l];
+			}
+		}
+		double * diag = col_j + j * lanes;
+		for(std::size_t l = 0; l < Used; ++l) {
+			const double pivot = diag[l] - sq_norm[l];
+			// A failed lane carries on with a unit pivot, so it cannot spoil the
+			// rest of its factorisation with NaNs.
+			positive[l] &= (pivot > 0);
+			diag[l] = pivot > 0 ? std::sqrt(pivot) : 1.0;
+		}
+	}
+}
+}
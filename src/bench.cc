@@ -3,6 +3,9 @@
 #include <polytope_check.h>
 
 #include "calc.h"
+#include "elliptic_factory.h"
+#include "polytope_candidate_n.h"
+#include "polytope_extender.h"
 
 using ptope::calc::min_cos_angle;
 static void EsselmanPolytopeCheck(benchmark::State& state) {
@@ -69,4 +72,65 @@ static void NotBigPolytopeCheck(benchmark::State& state) {
 }
 BENCHMARK(NotBigPolytopeCheck);
 
+/*
+ * Check the first candidates extending the elliptic diagram A_D, so that each
+ * size of the numeric kernels used by the check can be timed.
+ */
+template <std::size_t D>
+static void DimensionPolytopeCheck(benchmark::State& state) {
+	ptope::PolytopeExtender ext(
+			ptope::PolytopeCandidate(ptope::elliptic_factory::type_a(D)));
+	std::vector<ptope::PolytopeCandidate> candidates;
+	while(ext.has_next() && candidates.size() < 64) {
+		candidates.push_back(ext.next());
+	}
+	ptope::PolytopeCheck pcheck;
+  while (state.KeepRunning()) {
+		for(const ptope::PolytopeCandidate & c : candidates) {
+			benchmark::DoNotOptimize(pcheck(c));
+		}
+	}
+}
+BENCHMARK_TEMPLATE(DimensionPolytopeCheck, 3);
+BENCHMARK_TEMPLATE(DimensionPolytopeCheck, 4);
+BENCHMARK_TEMPLATE(DimensionPolytopeCheck, 5);
+BENCHMARK_TEMPLATE(DimensionPolytopeCheck, 6);
+BENCHMARK_TEMPLATE(DimensionPolytopeCheck, 7);
+BENCHMARK_TEMPLATE(DimensionPolytopeCheck, 8);
+BENCHMARK_TEMPLATE(DimensionPolytopeCheck, 9);
+BENCHMARK_TEMPLATE(DimensionPolytopeCheck, 10);
+
+/* Copy and extend a candidate, as done for each short-lived extension. */
+static void ExtendCandidate(benchmark::State& state) {
+	ptope::PolytopeCandidate p({ { 1, -.5, 0, 0 },
+												{ -.5, 1, min_cos_angle(4), 0 },
+												{ 0, min_cos_angle(4), 1, -.5 },
+												{ 0, 0, -.5, 1 } });
+	auto q = p.extend_by_inner_products({ 0, 0, 0, min_cos_angle(8) });
+	auto r = q.extend_by_inner_products({ min_cos_angle(8), 0, 0, 0 });
+	const arma::vec vec = r.vector_family().get(5);
+  while (state.KeepRunning()) {
+		ptope::PolytopeCandidate result = q.extend_by_vector(vec);
+		benchmark::DoNotOptimize(result.gram().memptr());
+	}
+}
+BENCHMARK(ExtendCandidate);
+
+static void ExtendCandidateN(benchmark::State& state) {
+	ptope::PolytopeCandidate p({ { 1, -.5, 0, 0 },
+												{ -.5, 1, min_cos_angle(4), 0 },
+												{ 0, min_cos_angle(4), 1, -.5 },
+												{ 0, 0, -.5, 1 } });
+	auto q = p.extend_by_inner_products({ 0, 0, 0, min_cos_angle(8) });
+	auto r = q.extend_by_inner_products({ min_cos_angle(8), 0, 0, 0 });
+	const arma::vec vec = r.vector_family().get(5);
+	const ptope::PolytopeCandidateN<4, 16> fixed(q);
+  while (state.KeepRunning()) {
+		ptope::PolytopeCandidateN<4, 16> result;
+		fixed.extend_by_vector(result, vec);
+		benchmark::DoNotOptimize(&result);
+	}
+}
+BENCHMARK(ExtendCandidateN);
+
 BENCHMARK_MAIN();
@@ -17,38 +17,44 @@
 #include "block_diagonal_check.h"
 
 namespace ptope {
-bool BlockDiagonalCheck::operator()(const arma::mat m) {
+std::size_t
+BlockDiagonalCheck::decompose(const arma::mat & m) {
 	_unvisited.clear();
-	_components.clear();
-	while(!_queue.empty()) {
-		_queue.pop();
-	}
 	for(arma::uword i = 0; i < m.n_cols; ++i) {
 		_unvisited.push_back(i);
 	}
-	arma::uword current_component = 0;
+	return priv_decompose(m);
+}
+/*
+ * Each component is found by a breadth first search, using the component
+ * itself as the queue of vectors whose neighbours are still to be found.
+ */
+std::size_t
+BlockDiagonalCheck::priv_decompose(const arma::mat & m) {
+	_n_components = 0;
 	while(!_unvisited.empty()) {
-		_components.push_back(std::vector<arma::uword>());
-		_queue.push(_unvisited.back());
+		if(_components.size() == _n_components) {
+			_components.emplace_back();
+		}
+		Component & component = _components[_n_components++];
+		component.clear();
+		component.push_back(_unvisited.back());
 		_unvisited.pop_back();
-		while(!_queue.empty()) {
-			arma::uword col = _queue.front();
-			_queue.pop();
-			for(auto unv_it = _unvisited.end(); unv_it > _unvisited.begin();) {
-				/* Here we need a reverse iterator, wbut one which can be used to erase
-				 * elements. Hence this slightly hacky version. */
-				--unv_it;
-				arma::uword row = *unv_it;
-				if(m(row,col) != 0) {
+		for(std::size_t next = 0; next < component.size(); ++next) {
+			const arma::uword col = component[next];
+			/* Iterate backwards, so that each erased entry can be replaced by the
+			 * last entry, which has already been checked. */
+			for(std::size_t u = _unvisited.size(); u > 0; --u) {
+				const arma::uword row = _unvisited[u - 1];
+				if(m(row, col) != 0) {
 					/* Vertex row is connected to vertex col */
-					_unvisited.erase(unv_it);
-					_components[current_component].push_back(row);
-					_queue.push(row);
+					component.push_back(row);
+					_unvisited[u - 1] = _unvisited.back();
+					_unvisited.pop_back();
 				}
 			}
 		}
 	}
-	return _components.size() == 1;
+	return _n_components;
 }
 }
-
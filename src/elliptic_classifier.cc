@@ -0,0 +1,321 @@
+/*
+ * elliptic_classifier.cc
+ * Copyright 2016 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "elliptic_classifier.h"
+
+#include <algorithm>
+
+#include "angles.h"
+
+namespace ptope {
+namespace {
+/* Label of orthogonal vectors, which are not joined in the diagram. */
+constexpr unsigned int orthogonal = 2;
+}
+constexpr unsigned int EllipticClassifier::no_label;
+EllipticClassifier::EllipticClassifier()
+	:	_size(0),
+		_labels() {}
+void
+EllipticClassifier::set_gram(const arma::mat & gram) {
+	const Angles & angles = Angles::get();
+	_size = gram.n_cols;
+	_labels.assign(_size * _size, no_label);
+	for(std::size_t j = 0; j < _size; ++j) {
+		for(std::size_t i = 0; i < j; ++i) {
+			const unsigned int m = angles.inner_product(gram(i, j));
+			_labels[i * _size + j] = m;
+			_labels[j * _size + i] = m;
+		}
+	}
+}
+/*
+ * The diagram is split into connected components by a depth first search, then
+ * each component is checked against the lists of elliptic and affine diagrams.
+ */
+EllipticClassifier::Result
+EllipticClassifier::classify(const std::vector<std::size_t> & indices) const {
+	const std::size_t size = indices.size();
+	_degree.assign(size, 0);
+	for(std::size_t a = 0; a < size; ++a) {
+		for(std::size_t b = 0; b < a; ++b) {
+			const unsigned int m = local_label(indices, a, b);
+			if(m == no_label) {
+				return Result::Unknown;
+			}
+			if(m != orthogonal) {
+				++_degree[a];
+				++_degree[b];
+			}
+		}
+	}
+	bool parabolic = false;
+	_seen.assign(size, false);
+	for(std::size_t start = 0; start < size; ++start) {
+		if(_seen[start]) {
+			continue;
+		}
+		_component.clear();
+		_stack.assign(1, start);
+		_seen[start] = true;
+		while(!_stack.empty()) {
+			const std::size_t a = _stack.back();
+			_stack.pop_back();
+			_component.push_back(a);
+			for(std::size_t b = 0; b < size; ++b) {
+				if(!_seen[b] && b != a && local_label(indices, a, b) != orthogonal) {
+					_seen[b] = true;
+					_stack.push_back(b);
+				}
+			}
+		}
+		switch(component_type(indices)) {
+			case Type::Other:
+				return Result::NotElliptic;
+			case Type::Affine:
+				parabolic = true;
+				break;
+			case Type::Elliptic:
+				break;
+		}
+	}
+	return parabolic ? Result::Parabolic : Result::Elliptic;
+}
+EllipticClassifier::Type
+EllipticClassifier::component_type(const std::vector<std::size_t> & indices)
+		const {
+	const std::size_t size = _component.size();
+	if(size == 1) {
+		return Type::Elliptic;
+	}
+	/* Positions are into indices, so only indices.size() is never a position. */
+	const std::size_t none = indices.size();
+	std::size_t edges = 0;
+	std::size_t max_degree = 0;
+	std::size_t n_branches = 0;
+	std::size_t branch = none;
+	std::size_t end = none;
+	for(std::size_t c = 0; c < size; ++c) {
+		const std::size_t a = _component[c];
+		edges += _degree[a];
+		max_degree = std::max(max_degree, _degree[a]);
+		if(_degree[a] >= 3) {
+			++n_branches;
+			branch = a;
+		} else if(_degree[a] == 1) {
+			end = a;
+		}
+		for(std::size_t d = 0; d < c; ++d) {
+			/* An angle of pi, or any other label below 2, is never elliptic. */
+			if(local_label(indices, a, _component[d]) < orthogonal) {
+				return Type::Other;
+			}
+		}
+	}
+	/* Each edge was counted from both ends. */
+	edges /= 2;
+	if(edges == size && max_degree == 2) {
+		/* Affine A_n is the only cycle. */
+		return simply_laced(indices) ? Type::Affine : Type::Other;
+	}
+	/* Otherwise both elliptic and affine diagrams are trees. */
+	if(edges != size - 1 || max_degree > 4) {
+		return Type::Other;
+	}
+	if(size == 2) {
+		/* I_2(m) for any finite label m. */
+		return Type::Elliptic;
+	}
+	if(max_degree == 4) {
+		/* Affine D_4 is the only diagram with a vertex of degree 4. */
+		return size == 5 && simply_laced(indices) ? Type::Affine : Type::Other;
+	}
+	switch(n_branches) {
+		case 0:
+			return path_type(indices, end);
+		case 1:
+			return branched_type(indices, branch);
+		case 2:
+			return two_branch_type(indices);
+		default:
+			return Type::Other;
+	}
+}
+/*
+ * A tree with one branch vertex and all labels 3 has arms of p - 1, q - 1 and
+ * r - 1 vertices. It gives D_n, E_6, E_7 or E_8 when 1/p + 1/q + 1/r > 1, and
+ * affine E_6, E_7 or E_8 when 1/p + 1/q + 1/r = 1.
+ *
+ * Otherwise the only possibility is affine B_n, which has a single label 4 at
+ * the end of one arm while the other two arms are single vertices.
+ */
+EllipticClassifier::Type
+EllipticClassifier::branched_type(const std::vector<std::size_t> & indices,
+		std::size_t branch) const {
+	std::size_t arms[3];
+	std::size_t n_arms = 0;
+	std::size_t n_high = 0;
+	std::size_t high_arm = 0;
+	bool high_at_leaf = false;
+	for(const std::size_t start : _component) {
+		if(start == branch || local_label(indices, branch, start) == orthogonal) {
+			continue;
+		}
+		std::size_t prev = branch;
+		std::size_t cur = start;
+		std::size_t length = 1;
+		while(true) {
+			const unsigned int m = local_label(indices, prev, cur);
+			if(m != 3) {
+				if(m != 4 || ++n_high > 1) {
+					return Type::Other;
+				}
+				high_arm = n_arms;
+				high_at_leaf = _degree[cur] == 1;
+			}
+			if(_degree[cur] == 1) {
+				break;
+			}
+			std::size_t next = cur;
+			for(const std::size_t c : _component) {
+				if(c != cur && c != prev
+						&& local_label(indices, cur, c) != orthogonal) {
+					next = c;
+					break;
+				}
+			}
+			prev = cur;
+			cur = next;
+			++length;
+		}
+		arms[n_arms++] = length + 1;
+	}
+	if(n_high == 1) {
+		return high_at_leaf && arms[(high_arm + 1) % 3] == 2
+			&& arms[(high_arm + 2) % 3] == 2 ? Type::Affine : Type::Other;
+	}
+	const std::size_t p = arms[0];
+	const std::size_t q = arms[1];
+	const std::size_t r = arms[2];
+	const std::size_t sum = q * r + p * r + p * q;
+	if(sum > p * q * r) {
+		return Type::Elliptic;
+	}
+	return sum == p * q * r ? Type::Affine : Type::Other;
+}
+/*
+ * The only tree with two branch vertices which is elliptic or affine is affine
+ * D_n, where both branch vertices are joined to two leaves and all labels are
+ * 3. In a tree with two branch vertices these are all four leaves.
+ */
+EllipticClassifier::Type
+EllipticClassifier::two_branch_type(const std::vector<std::size_t> & indices)
+		const {
+	if(!simply_laced(indices)) {
+		return Type::Other;
+	}
+	for(const std::size_t a : _component) {
+		if(_degree[a] != 3) {
+			continue;
+		}
+		std::size_t leaves = 0;
+		for(const std::size_t b : _component) {
+			if(b != a && _degree[b] == 1
+					&& local_label(indices, a, b) != orthogonal) {
+				++leaves;
+			}
+		}
+		if(leaves != 2) {
+			return Type::Other;
+		}
+	}
+	return Type::Affine;
+}
+/*
+ * Paths with all labels 3 are A_n. With one larger label, a 4 at either end
+ * gives B_n, a 4 in the middle of four vertices gives F_4, and a 5 at the end
+ * of three or four vertices gives H_3 or H_4, while a 4 in the middle of five
+ * vertices gives affine F_4 and a 6 at the end of three vertices gives affine
+ * G_2. With two larger labels, only a 4 at both ends, affine C_n, is possible.
+ */
+EllipticClassifier::Type
+EllipticClassifier::path_type(const std::vector<std::size_t> & indices,
+		std::size_t end) const {
+	const std::size_t size = _component.size();
+	const std::size_t n_edges = size - 1;
+	std::size_t high_pos[2];
+	unsigned int high_label[2];
+	std::size_t n_high = 0;
+	std::size_t prev = end;
+	std::size_t cur = end;
+	for(std::size_t pos = 0; pos < n_edges; ++pos) {
+		std::size_t next = cur;
+		for(const std::size_t c : _component) {
+			if(c != cur && c != prev && local_label(indices, cur, c) != orthogonal) {
+				next = c;
+				break;
+			}
+		}
+		const unsigned int m = local_label(indices, cur, next);
+		if(m > 3) {
+			if(n_high == 2) {
+				return Type::Other;
+			}
+			high_pos[n_high] = pos;
+			high_label[n_high] = m;
+			++n_high;
+		}
+		prev = cur;
+		cur = next;
+	}
+	if(n_high == 0) {
+		return Type::Elliptic;
+	}
+	if(n_high == 2) {
+		return high_label[0] == 4 && high_label[1] == 4 && high_pos[0] == 0
+			&& high_pos[1] == n_edges - 1 ? Type::Affine : Type::Other;
+	}
+	const std::size_t pos = high_pos[0];
+	const bool at_end = pos == 0 || pos == n_edges - 1;
+	switch(high_label[0]) {
+		case 4:
+			if(at_end || (size == 4 && pos == 1)) {
+				return Type::Elliptic;
+			}
+			return size == 5 && (pos == 1 || pos == 2) ? Type::Affine : Type::Other;
+		case 5:
+			return at_end && size <= 4 ? Type::Elliptic : Type::Other;
+		case 6:
+			return size == 3 ? Type::Affine : Type::Other;
+		default:
+			return Type::Other;
+	}
+}
+bool
+EllipticClassifier::simply_laced(const std::vector<std::size_t> & indices)
+		const {
+	for(std::size_t c = 0, size = _component.size(); c < size; ++c) {
+		for(std::size_t d = 0; d < c; ++d) {
+			const unsigned int m = local_label(indices, _component[c],
+					_component[d]);
+			if(m != orthogonal && m != 3) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+}
@@ -0,0 +1,64 @@
+/*
+ * fixed_cholesky.cc
+ * Copyright 2016 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "fixed_cholesky.h"
+
+namespace ptope {
+namespace fixed_cholesky {
+namespace {
+/** Instantiations of the kernels, indexed by their size. */
+struct Kernels {
+	bool (*chol_in_place)(double *, std::size_t);
+	bool (*schur_positive)(double const *, std::size_t, double *, double);
+};
+Kernels const kernels[max_size + 1] = {
+	{ nullptr, nullptr },
+	{ &chol_in_place<1>, &schur_positive<1> },
+	{ &chol_in_place<2>, &schur_positive<2> },
+	{ &chol_in_place<3>, &schur_positive<3> },
+	{ &chol_in_place<4>, &schur_positive<4> },
+	{ &chol_in_place<5>, &schur_positive<5> },
+	{ &chol_in_place<6>, &schur_positive<6> },
+	{ &chol_in_place<7>, &schur_positive<7> },
+	{ &chol_in_place<8>, &schur_positive<8> },
+	{ &chol_in_place<9>, &schur_positive<9> },
+};
+}
+bool
+chol_in_place(double * mat, std::size_t size, std::size_t ld) {
+	return kernels[size].chol_in_place(mat, ld);
+}
+bool
+schur_positive(double const * chol, std::size_t size, std::size_t ld,
+		double * col, double diag) {
+	if(size > 0 && size <= max_size) {
+		return kernels[size].schur_positive(chol, ld, col, diag);
+	}
+	double sq_norm = 0;
+	for(std::size_t k = 0; k < size; ++k) {
+		double const * chol_col = chol + k * ld;
+		double dot = 0;
+		for(std::size_t l = 0; l < k; ++l) {
+			dot += chol_col[l] * col[l];
+		}
+		double const val = (col[k] - dot) * (1.0 / chol_col[k]);
+		col[k] = val;
+		sq_norm += val * val;
+	}
+	return diag - sq_norm > 0;
+}
+}
+}
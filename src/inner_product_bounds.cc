@@ -0,0 +1,237 @@
+/*
+ * inner_product_bounds.cc
+ * Copyright 2015 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "inner_product_bounds.h"
+
+#include "angles.h"
+#include "calc.h"
+
+#include <algorithm>
+
+namespace ptope {
+namespace {
+/* Same tolerance as used when extending candidates. */
+constexpr double error = 10e-10;
+/* Relative slack given to each bound before a subtree is pruned. */
+constexpr double tolerance = 1e-8;
+/* Below this the nullspace vector is too close to lightlike to trust G^-1. */
+constexpr double degenerate = 1e-6;
+/* Tolerance used by AngleCheck when comparing a product to the angles. */
+constexpr double angle_error = 1e-10;
+}
+InnerProductBounds::InnerProductBounds(const PolytopeCandidate & candidate,
+		const Domains & domains, const DottedRange & dotted, bool check_angles)
+	:	_size(candidate.real_dimension()),
+		_non_basis(0),
+		_lo(_size, 0),
+		_hi(_size, 0),
+		_max_sq(_size + 1, 0),
+		_null_norm(-1),
+		_margin(tolerance),
+		_check_norm(true),
+		_norm_above(true),
+		_check_signs(false),
+		_dotted(dotted),
+		_check_dotted(dotted.restricted()),
+		_check_angles(check_angles),
+		_angles(check_angles ? Angles::get().inner_products()
+				: std::vector<double>()),
+		_always_dotted(_size + 1, 0),
+		_maybe_dotted(_size + 1, 0),
+		_fixed_dotted(_size + 1, 0),
+		_state(_size + 1, _size + 1) {
+	double largest_sq = 0;
+	for(std::size_t i = 0; i < _size; ++i) {
+		const std::vector<double> & values = domains[i];
+		if(!values.empty()) {
+			_lo[i] = *std::min_element(values.begin(), values.end());
+			_hi[i] = *std::max_element(values.begin(), values.end());
+		}
+		const double sq = std::max(_lo[i] * _lo[i], _hi[i] * _hi[i]);
+		_max_sq[i + 1] = _max_sq[i] + sq;
+		largest_sq = std::max(largest_sq, sq);
+		const std::size_t n_dotted = std::count_if(values.begin(), values.end(),
+				calc::is_dotted);
+		_always_dotted[i + 1] = _always_dotted[i]
+			+ (!values.empty() && n_dotted == values.size() ? 1 : 0);
+		_maybe_dotted[i + 1] = _maybe_dotted[i] + (n_dotted > 0 ? 1 : 0);
+	}
+	const arma::mat & gram = candidate.gram();
+	const VectorFamily & vectors = candidate.vector_family();
+	if(candidate.hyperbolic()) {
+		const arma::vec & null_vec = candidate.null_vector();
+		_null_norm = calc::mink_sq_norm(null_vec);
+		_check_norm = std::abs(_null_norm) > degenerate;
+		_norm_above = _null_norm < 0;
+		/* When the nullspace is the time direction the extension never checks
+		 * the signs of the products with the non-basis vectors. */
+		_check_signs = _check_norm && vectors.size() > _size
+			&& std::abs(_null_norm + 1) >= error;
+		if(_check_signs || ((_check_dotted || _check_angles) && _check_norm)) {
+			_non_basis = vectors.size() - _size;
+			_null_products.set_size(_non_basis);
+			for(std::size_t j = 0; j < _non_basis; ++j) {
+				_null_products(j) = calc::mink_inner_prod(null_vec.size(),
+						null_vec.memptr(), vectors.get_ptr(_size + j));
+			}
+		}
+	}
+	if(!_check_norm ||
+			!arma::inv(_gram_inv, gram.submat(0, 0, _size - 1, _size - 1))) {
+		_check_norm = false;
+		_check_signs = false;
+		_check_dotted = false;
+		_check_angles = false;
+		_non_basis = 0;
+		return;
+	}
+	/* Remove any asymmetry introduced by the inversion. */
+	_gram_inv = 0.5 * (_gram_inv + _gram_inv.t());
+	double max_entry = 0;
+	for(const double & x : _gram_inv) {
+		max_entry = std::max(max_entry, std::abs(x));
+	}
+	_margin = tolerance * (1.0 + max_entry * _size * largest_sq);
+
+	_eig_min.zeros(_size + 1);
+	_eig_max.zeros(_size + 1);
+	arma::vec eigvals;
+	for(std::size_t r = 1; r <= _size; ++r) {
+		arma::eig_sym(eigvals, _gram_inv.submat(0, 0, r - 1, r - 1));
+		_eig_min(r) = eigvals(0);
+		_eig_max(r) = eigvals(r - 1);
+	}
+	if(_non_basis > 0) {
+		_coeffs = _gram_inv * gram.submat(0, _size, _size - 1, gram.n_cols - 1);
+		_remaining_min.zeros(_non_basis, _size + 1);
+		_remaining_max.zeros(_non_basis, _size + 1);
+		for(std::size_t j = 0; j < _non_basis; ++j) {
+			for(std::size_t r = 1; r <= _size; ++r) {
+				const double c = _coeffs(r - 1, j);
+				_remaining_min(j, r) = _remaining_min(j, r - 1)
+					+ std::min(c * _lo[r - 1], c * _hi[r - 1]);
+				_remaining_max(j, r) = _remaining_max(j, r - 1)
+					+ std::max(c * _lo[r - 1], c * _hi[r - 1]);
+			}
+		}
+	}
+	_state.zeros(_size + 1 + _non_basis, _size + 1);
+}
+void
+InnerProductBounds::fix(std::size_t index, double value) {
+	if(!_check_norm) {
+		return;
+	}
+	const double * prev = _state.colptr(index + 1);
+	double * cur = _state.colptr(index);
+	const double * inv_col = _gram_inv.colptr(index);
+	for(std::size_t i = 0; i < _size; ++i) {
+		cur[i] = prev[i] + value * inv_col[i];
+	}
+	cur[_size] = prev[_size] + value * (2 * prev[index] + value * inv_col[index]);
+	for(std::size_t j = 0, ind = _size + 1; j < _non_basis; ++j, ++ind) {
+		cur[ind] = prev[ind] + value * _coeffs(index, j);
+	}
+	_fixed_dotted[index] = _fixed_dotted[index + 1]
+		+ (calc::is_dotted(value) ? 1 : 0);
+}
+bool
+InnerProductBounds::can_prune(std::size_t index) const {
+	if(!_check_norm) {
+		return false;
+	}
+	const double * cur = _state.colptr(index);
+	/* The coordinates before index are still free. The cross terms between
+	 * fixed and free coordinates are linear in each free coordinate, while the
+	 * free block is bounded by its extreme eigenvalues. */
+	double q_min = cur[_size];
+	double q_max = cur[_size];
+	for(std::size_t k = 0; k < index; ++k) {
+		const double lo = 2 * cur[k] * _lo[k];
+		const double hi = 2 * cur[k] * _hi[k];
+		q_min += std::min(lo, hi);
+		q_max += std::max(lo, hi);
+	}
+	const double spread = _max_sq[index];
+	q_min += std::min(0.0, _eig_min(index)) * spread;
+	q_max += std::max(0.0, _eig_max(index)) * spread;
+	if(_norm_above ? q_max < 1.0 - _margin : q_min > 1.0 + _margin) {
+		return true;
+	}
+	if(!_check_signs && !_check_dotted && !_check_angles) {
+		return false;
+	}
+	/* Largest possible coefficient of the nullspace vector. */
+	const double s_sq = _norm_above ? (q_max - 1.0) / -_null_norm
+		: (1.0 - q_min) / _null_norm;
+	const double s_max = std::sqrt(std::max(0.0, s_sq));
+	if(_check_signs) {
+		bool plus_fails = false;
+		bool minus_fails = false;
+		for(std::size_t j = 0; j < _non_basis && !(plus_fails && minus_fails);
+				++j) {
+			const double prod = cur[_size + 1 + j] + _remaining_min(j, index);
+			const double null_part = _null_products(j) * s_max;
+			if(prod + std::min(0.0, null_part) > error + _margin) {
+				plus_fails = true;
+			}
+			if(prod + std::min(0.0, -null_part) > error + _margin) {
+				minus_fails = true;
+			}
+		}
+		if(plus_fails && minus_fails) {
+			return true;
+		}
+	}
+	if(_check_angles) {
+		for(std::size_t j = 0; j < _non_basis; ++j) {
+			const double prod = cur[_size + 1 + j];
+			const double null_part = std::abs(_null_products(j)) * s_max;
+			if(!angle_between(prod + _remaining_min(j, index) - null_part - _margin,
+						prod + _remaining_max(j, index) + null_part + _margin)) {
+				return true;
+			}
+		}
+	}
+	if(!_check_dotted) {
+		return false;
+	}
+	/* Count the products which are dotted for every completion, and those which
+	 * are dotted for at least one. */
+	std::size_t surely = _fixed_dotted[index] + _always_dotted[index];
+	std::size_t maybe = _fixed_dotted[index] + _maybe_dotted[index];
+	for(std::size_t j = 0; j < _non_basis; ++j) {
+		const double prod = cur[_size + 1 + j];
+		const double null_part = std::abs(_null_products(j)) * s_max;
+		if(calc::is_dotted(prod + _remaining_max(j, index) + null_part + _margin)) {
+			++surely;
+		}
+		if(calc::is_dotted(prod + _remaining_min(j, index) - null_part - _margin)) {
+			++maybe;
+		}
+	}
+	return surely > _dotted.max || maybe < _dotted.min;
+}
+bool
+InnerProductBounds::angle_between(double lo, double hi) const {
+	if(lo < angle_error - 1.0) {
+		return true;
+	}
+	const auto it = std::lower_bound(_angles.begin(), _angles.end(),
+			lo - angle_error);
+	return it != _angles.end() && *it <= hi + angle_error;
+}
+}
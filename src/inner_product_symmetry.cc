@@ -0,0 +1,145 @@
+/*
+ * inner_product_symmetry.cc
+ * Copyright 2015 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "inner_product_symmetry.h"
+
+#include <cmath>
+
+namespace ptope {
+namespace {
+constexpr double error = 1e-10;
+/* Stop looking for automorphisms after this many, as for highly symmetric
+ * seeds (such as many orthogonal vectors) the full group is huge. */
+constexpr std::size_t max_perms = 20000;
+bool
+equal(double a, double b) {
+	return std::abs(a - b) < error;
+}
+}
+InnerProductSymmetry::InnerProductSymmetry(const PolytopeCandidate & candidate)
+	:	_size(candidate.real_dimension()),
+		_n_perms(0),
+		_classes(_size, 0),
+		_digits(_size, 0),
+		_smaller(false) {
+	init(candidate.gram());
+}
+InnerProductSymmetry::InnerProductSymmetry(const PolytopeCandidate & candidate,
+		const std::vector<std::vector<double>> & domains)
+	:	_size(candidate.real_dimension()),
+		_n_perms(0),
+		_classes(_size, 0),
+		_digits(_size, 0),
+		_smaller(false) {
+	for(std::size_t i = 0; i < _size; ++i) {
+		std::size_t c = 0;
+		while(c < i && domains[c] != domains[i]) {
+			++c;
+		}
+		_classes[i] = c;
+	}
+	init(candidate.gram());
+}
+void
+InnerProductSymmetry::init(const arma::mat & gram) {
+	std::vector<std::size_t> perms;
+	std::vector<std::size_t> perm(_size);
+	std::vector<bool> used(_size, false);
+	find_automorphisms(gram, perms, perm, used, 0);
+	_n_perms = perms.size() / _size;
+	_perms = std::make_shared<const std::vector<std::size_t>>(std::move(perms));
+	/* Block _size is the state before any entries are fixed, where every
+	 * comparison starts at the last entry. */
+	_state.assign(_n_perms * (_size + 1), 0);
+	for(std::size_t p = 0; p < _n_perms; ++p) {
+		_state[_size * _n_perms + p] = _size;
+	}
+}
+/*
+ * Build the permutation one basis vector at a time, checking that each new
+ * image has the right products with the images already chosen and with every
+ * non-basis vector.
+ */
+void
+InnerProductSymmetry::find_automorphisms(const arma::mat & gram,
+		std::vector<std::size_t> & perms, std::vector<std::size_t> & perm,
+		std::vector<bool> & used, std::size_t index) {
+	if(perms.size() >= max_perms * _size) {
+		return;
+	}
+	if(index == _size) {
+		bool identity = true;
+		for(std::size_t i = 0; i < _size && identity; ++i) {
+			identity = perm[i] == i;
+		}
+		if(!identity) {
+			perms.insert(perms.end(), perm.begin(), perm.end());
+		}
+		return;
+	}
+	for(std::size_t image = 0; image < _size; ++image) {
+		if(used[image] || _classes[image] != _classes[index]
+				|| !equal(gram(image, image), gram(index, index))) {
+			continue;
+		}
+		bool valid = true;
+		for(std::size_t k = 0; k < index && valid; ++k) {
+			valid = equal(gram(image, perm[k]), gram(index, k));
+		}
+		for(std::size_t m = _size; m < gram.n_cols && valid; ++m) {
+			valid = equal(gram(image, m), gram(index, m));
+		}
+		if(valid) {
+			perm[index] = image;
+			used[image] = true;
+			find_automorphisms(gram, perms, perm, used, index + 1);
+			used[image] = false;
+		}
+	}
+}
+/*
+ * The permuted vector has entry b[s(i)] at i. Entries are compared from the
+ * last down, which can continue as long as both i and s(i) are fixed.
+ */
+void
+InnerProductSymmetry::fix(std::size_t index, std::size_t digit) {
+	_digits[index] = digit;
+	_smaller = false;
+	const std::size_t * prev = _state.data() + (index + 1) * _n_perms;
+	std::size_t * cur = _state.data() + index * _n_perms;
+	for(std::size_t p = 0; p < _n_perms; ++p) {
+		std::size_t pos = prev[p];
+		const std::size_t * perm = _perms->data() + p * _size;
+		while(pos > 0) {
+			const std::size_t i = pos - 1;
+			const std::size_t image = perm[i];
+			if(i < index || image < index) {
+				break;
+			}
+			if(_digits[image] < _digits[i]) {
+				_smaller = true;
+				return;
+			}
+			if(_digits[image] > _digits[i]) {
+				pos = 0;
+			} else {
+				--pos;
+			}
+		}
+		cur[p] = pos;
+	}
+}
+}
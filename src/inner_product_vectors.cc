@@ -18,14 +18,123 @@
 
 #include "angles.h"
 
+#include <algorithm>
+
 namespace ptope {
-InnerProductVectors::InnerProductVectors(int size)
-	:	_inner_products(Angles::get().inner_products()),
-		_next(size),
-		_progress(size),
-		_progress_max(_inner_products.size() - 1),
-		_has_next(true) {
-	std::reverse(_inner_products.begin(), _inner_products.end());
+namespace {
+/* Largest position in each domain. Empty domains give no vectors at all, so
+ * their value is never used. */
+std::vector<std::size_t>
+domain_maxima(const InnerProductVectors::Domains & domains) {
+	std::vector<std::size_t> result(domains.size(), 0);
+	for(std::size_t i = 0, max = domains.size(); i < max; ++i) {
+		if(!domains[i].empty()) {
+			result[i] = domains[i].size() - 1;
+		}
+	}
+	return result;
+}
+}
+InnerProductVectors::InnerProductVectors(int size, Order order)
+	:	InnerProductVectors(size, Range(), order) {}
+InnerProductVectors::InnerProductVectors(int size, const Range & range,
+		Order order)
+	:	InnerProductVectors(default_domains(size), range, order) {}
+InnerProductVectors::InnerProductVectors(const Domains & domains,
+		const Range & range, Order order)
+	:	_inner_products(domains),
+		_next(domains.size()),
+		_progress(domains.size()),
+		_progress_max(domain_maxima(domains)),
+		_has_next(true),
+		_pruned(0),
+		_order(order),
+		_ascending(domains.size(), true) {
+	init_range(range);
+}
+InnerProductVectors::InnerProductVectors(const PolytopeCandidate & candidate)
+	:	InnerProductVectors(candidate, Range()) {}
+InnerProductVectors::InnerProductVectors(const PolytopeCandidate & candidate,
+		const Range & range)
+	:	InnerProductVectors(candidate, range, true, false) {}
+InnerProductVectors::InnerProductVectors(const PolytopeCandidate & candidate,
+		const Range & range, bool use_bounds, bool use_symmetry)
+	:	InnerProductVectors(candidate,
+			default_domains(candidate.real_dimension()), range, use_bounds,
+			use_symmetry) {}
+InnerProductVectors::InnerProductVectors(const PolytopeCandidate & candidate,
+		const Domains & domains, const Range & range, bool use_bounds,
+		bool use_symmetry, const InnerProductBounds::DottedRange & dotted,
+		bool check_angles, Order order)
+	:	_inner_products(domains),
+		_next(candidate.real_dimension()),
+		_progress(candidate.real_dimension()),
+		_progress_max(domain_maxima(domains)),
+		_has_next(true),
+		_bounds(use_bounds ?
+				new InnerProductBounds(candidate, _inner_products, dotted,
+					check_angles) : nullptr),
+		_symmetry(use_symmetry ?
+				new InnerProductSymmetry(candidate, _inner_products) : nullptr),
+		_pruned(0),
+		_order(order),
+		_ascending(candidate.real_dimension(), true) {
+	init_range(range);
+}
+InnerProductVectors::InnerProductVectors(const InnerProductVectors & other,
+		const Range & range)
+	:	_inner_products(other._inner_products),
+		_next(other._next.n_elem),
+		_progress(other._progress.size()),
+		_progress_max(other._progress_max),
+		_has_next(true),
+		_bounds(other._bounds ? new InnerProductBounds(*other._bounds) : nullptr),
+		_symmetry(other._symmetry ?
+				new InnerProductSymmetry(*other._symmetry) : nullptr),
+		_pruned(0),
+		_order(other._order),
+		_ascending(other._ascending.size(), true) {
+	init_range(range);
+}
+InnerProductVectors::Domains
+InnerProductVectors::default_domains(std::size_t size) {
+	std::vector<double> products(Angles::get().inner_products());
+	std::reverse(products.begin(), products.end());
+	return Domains(size, products);
+}
+InnerProductVectors::Domains
+InnerProductVectors::label_domains(
+		const std::vector<Angles::PiSubmultiples> & labels) {
+	Domains result;
+	result.reserve(labels.size());
+	for(const Angles::PiSubmultiples & angles : labels) {
+		std::vector<double> products(Angles::angles_to_prods(angles).first);
+		std::reverse(products.begin(), products.end());
+		result.push_back(std::move(products));
+	}
+	return result;
+}
+InnerProductVectors::Domains
+InnerProductVectors::mask_domains(const std::vector<std::uint64_t> & masks) {
+	std::vector<Angles::PiSubmultiples> labels(masks.size());
+	for(std::size_t i = 0, max = masks.size(); i < max; ++i) {
+		/* The angles pi and pi/1 do not give valid inner products. */
+		for(unsigned int m = 2; m < 64; ++m) {
+			if((masks[i] >> m) & 1) {
+				labels[i].push_back(m);
+			}
+		}
+	}
+	return label_domains(labels);
+}
+InnerProductVectors::Range
+InnerProductVectors::chunk(std::size_t index, std::size_t n_chunks) const {
+	const std::size_t total = _strides.back();
+	const std::size_t quot = total / n_chunks;
+	const std::size_t rem = total % n_chunks;
+	/* The first rem chunks each get one extra vector. */
+	const std::size_t begin = index * quot + std::min(index, rem);
+	return Range(begin, begin + quot + (index < rem ? 1 : 0));
 }
 bool
 InnerProductVectors::has_next() {
@@ -33,35 +142,212 @@ InnerProductVectors::has_next() {
 }
 const arma::vec &
 InnerProductVectors::next() {
-	compute_next();
+	compute_next(_next.memptr());
+	_changed = _next_changed;
+	_change = _next_change;
 	increment_progress();
 	return _next;
 }
+arma::uword
+InnerProductVectors::next_block(arma::mat & block, arma::uword max_cols,
+		std::vector<std::size_t> * ranks) {
+	const arma::uword size = _progress.size();
+	block.set_size(size, max_cols);
+	if(ranks != nullptr) {
+		ranks->clear();
+	}
+	arma::uword filled = 0;
+	for(; _has_next && filled < max_cols; ++filled) {
+		compute_next(block.colptr(filled));
+		if(ranks != nullptr) {
+			ranks->push_back(_rank);
+		}
+		increment_progress();
+	}
+	if(filled < max_cols) {
+		block.resize(size, filled);
+	}
+	return filled;
+}
 void
 InnerProductVectors::reset() {
-	_progress.assign(_progress.size(), 0);
+	_pruned = 0;
+	seek(_begin);
+}
+std::size_t
+InnerProductVectors::rank() const {
+	return _has_next ? _rank : _end;
+}
+void
+InnerProductVectors::seek(std::size_t rank) {
+	_next_changed = _progress.size();
+	_next_change = 0;
+	_changed = _progress.size();
+	_change = 0;
+	if(rank >= _end) {
+		_rank = _end;
+		_has_next = false;
+		return;
+	}
+	_rank = rank;
 	_has_next = true;
+	set_progress(rank);
+	if((_bounds || _symmetry) && !_progress.empty()) {
+		skip_pruned(_progress.size() - 1);
+	}
+}
+/*
+ * The rank written in the mixed radix given by the domain sizes gives the
+ * entries in lexicographic order. In Gray code order the entry at i is
+ * reflected, and moving downwards, whenever the number formed by the digits
+ * above i is odd.
+ */
+std::size_t
+InnerProductVectors::set_progress(std::size_t rank) {
+	std::size_t top = 0;
+	for(std::size_t i = 0, max = _progress.size(); i < max; ++i) {
+		const std::size_t old = _progress[i];
+		const std::size_t digit = (rank / _strides[i]) % (_progress_max[i] + 1);
+		if(_order == Order::Gray) {
+			const bool odd = (rank / _strides[i + 1]) % 2 == 1;
+			_progress[i] = odd ? _progress_max[i] - digit : digit;
+			_ascending[i] = !odd;
+		} else {
+			_progress[i] = digit;
+		}
+		if(_progress[i] != old) {
+			top = i;
+		}
+	}
+	return top;
+}
+void
+InnerProductVectors::init_range(const Range & range) {
+	const std::size_t max = _progress.size();
+	_strides.resize(max + 1);
+	_strides[0] = 1;
+	for(std::size_t i = 0; i < max; ++i) {
+		_strides[i + 1] = _strides[i] * _inner_products[i].size();
+	}
+	_end = std::min(range.end, _strides.back());
+	_begin = std::min(range.begin, _end);
+	reset();
 }
 void
 InnerProductVectors::increment_progress() {
+	if(_order == Order::Gray) {
+		increment_gray();
+		if((_bounds || _symmetry) && _has_next) {
+			skip_pruned(_next_changed);
+		}
+		return;
+	}
+	std::size_t top = increment_from(0);
+	if((_bounds || _symmetry) && _has_next) {
+		skip_pruned(top);
+	}
+}
+std::size_t
+InnerProductVectors::increment_from(std::size_t start) {
+	/* Move to the start of the subtree at start, so that incrementing the entry
+	 * there moves on by exactly one subtree. */
+	for(std::size_t i = 0; i < start; ++i) {
+		_rank -= _progress[i] * _strides[i];
+		_progress[i] = 0;
+	}
 	bool rollover = true;
-	std::size_t i = 0;
+	std::size_t i = start;
 	const std::size_t max = _progress.size();
 	for(; rollover && i < max; ++i) {
 		rollover = false;
-		if(++_progress[i] > _progress_max) {
+		if(++_progress[i] > _progress_max[i]) {
 			_progress[i] = 0;
 			rollover = true;
 		}
 	}
-	if(i == max && rollover) {
+	_rank += _strides[start];
+	if((i == max && rollover) || _rank >= _end) {
+		_has_next = false;
+	}
+	return i - 1;
+}
+/*
+ * Each entry sweeps up or down through the inner products, reversing direction
+ * when it reaches the end. The first entry which can still move in its current
+ * direction is moved, while those before it reverse direction and stay put.
+ */
+void
+InnerProductVectors::increment_gray() {
+	for(std::size_t i = 0, max = _progress.size(); i < max; ++i) {
+		const std::size_t current = _progress[i];
+		if(_ascending[i] ? current < _progress_max[i] : current > 0) {
+			_progress[i] = _ascending[i] ? current + 1 : current - 1;
+			_next_changed = i;
+			_next_change = _inner_products[i][_progress[i]]
+				- _inner_products[i][current];
+			if(++_rank >= _end) {
+				_has_next = false;
+			}
+			return;
+		}
+		_ascending[i] = !_ascending[i];
+	}
+	_has_next = false;
+}
+/*
+ * The vectors sharing the entries from start onwards are consecutive in Gray
+ * code order too, as the entries at and above start only depend on the rank
+ * divided by the stride at start.
+ */
+std::size_t
+InnerProductVectors::skip_gray(std::size_t start) {
+	const std::size_t stride = _strides[start];
+	_rank = (_rank / stride + 1) * stride;
+	_next_changed = _progress.size();
+	_next_change = 0;
+	if(_rank >= _end) {
 		_has_next = false;
+		return start;
+	}
+	return std::max(start, set_progress(_rank));
+}
+/*
+ * Entries are fixed from the last to the first, as the last entry changes
+ * slowest. Whenever the entries fixed so far cannot lead to a valid vector,
+ * the whole subtree below is skipped by incrementing the counter at that
+ * entry, so the next vector considered is the first in the following subtree.
+ */
+void
+InnerProductVectors::skip_pruned(std::size_t top) {
+	std::size_t index = top;
+	while(true) {
+		bool prune = false;
+		if(_bounds) {
+			_bounds->fix(index, _inner_products[index][_progress[index]]);
+			prune = _bounds->can_prune(index);
+		}
+		if(_symmetry && !prune) {
+			_symmetry->fix(index, _progress[index]);
+			prune = _symmetry->can_prune(index);
+		}
+		if(prune) {
+			++_pruned;
+			index = (_order == Order::Gray) ? skip_gray(index)
+				: increment_from(index);
+			if(!_has_next) {
+				return;
+			}
+		} else if(index == 0) {
+			return;
+		} else {
+			--index;
+		}
 	}
 }
 void
-InnerProductVectors::compute_next() {
+InnerProductVectors::compute_next(double * out) const {
 	for(std::size_t i = 0, max = _progress.size(); i < max; ++i) {
-		_next(i) = _inner_products[_progress[i]];
+		out[i] = _inner_products[i][_progress[i]];
 	}
 }
 }
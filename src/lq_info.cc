@@ -19,21 +19,25 @@
 namespace ptope {
 namespace detail {
 namespace {
-arma::mat __li_cache;
-arma::mat __orthog_cache;
-arma::podarray<double> __work;
-arma::podarray<double> __tau;
-arma::vec __nullvec;
+LQInfo::Workspace &
+local_workspace() {
+	static thread_local LQInfo::Workspace ws;
+	return ws;
+}
 }
 std::unique_ptr<LQInfo>
 LQInfo::compute(arma::mat const & A) {
+	return compute(A, local_workspace());
+}
+std::unique_ptr<LQInfo>
+LQInfo::compute(arma::mat const & A, Workspace & ws) {
 	using arma::uword;
 	using arma::blas_int;
 	const uword A_n_rows = A.n_rows;
 	const uword A_n_cols = A.n_cols;
 	std::unique_ptr<LQInfo> result(new LQInfo(A_n_rows));
-	__orthog_cache.set_size(A_n_cols, A_n_cols);
-	__orthog_cache.submat(0, 0, A_n_rows - 1, A_n_cols - 1) = A;
+	ws.orthog.set_size(A_n_cols, A_n_cols);
+	ws.orthog.submat(0, 0, A_n_rows - 1, A_n_cols - 1) = A;
 
 	blas_int m(A_n_rows);
 	blas_int n(A_n_cols);
@@ -45,29 +49,29 @@ LQInfo::compute(arma::mat const & A) {
 	double work_query[2];
 	blas_int lwork_query(-1);
 
-	__tau.set_min_size(static_cast<uword>(k));
+	ws.tau.set_min_size(static_cast<uword>(k));
 
 	/* Find the optimum work space size for computing LQ */
-	arma_fortran(dgelqf)(&m, &n, __orthog_cache.memptr(), &lda, __tau.memptr(),
+	arma_fortran(dgelqf)(&m, &n, ws.orthog.memptr(), &lda, ws.tau.memptr(),
 			&work_query[0], &lwork_query, &info);
 
 	blas_int lwork_proposed = static_cast<blas_int>(
 			arma::access::tmp_real(work_query[0]) );
 	blas_int lwork = (std::max)(lwork_proposed, lwork_min);
-	__work.set_min_size( static_cast<uword>(lwork) );
+	ws.work.set_min_size( static_cast<uword>(lwork) );
 
 	/* Compute LQ decomposition of A */
-	arma_fortran(dgelqf)(&m, &n, __orthog_cache.memptr(), &lda, __tau.memptr(),
-			__work.memptr(), &lwork, &info);
-	__li_cache = arma::inv(arma::trimatl(__orthog_cache.submat(0, 0, A_n_rows -
+	arma_fortran(dgelqf)(&m, &n, ws.orthog.memptr(), &lda, ws.tau.memptr(),
+			ws.work.memptr(), &lwork, &info);
+	ws.li = arma::inv(arma::trimatl(ws.orthog.submat(0, 0, A_n_rows -
 					1, A_n_rows - 1)));
 	/* Compute orthogonal matrix from LQ decomp to get nullspace */
-	arma_fortran(dorglq)(&n, &n, &k, __orthog_cache.memptr(), &n, __tau.memptr(),
-			__work.memptr(), &lwork, &info);
+	arma_fortran(dorglq)(&n, &n, &k, ws.orthog.memptr(), &n, ws.tau.memptr(),
+			ws.work.memptr(), &lwork, &info);
 
 	/* Write nullspace to output. */
-	result->_nullspace = __orthog_cache.row(A_n_rows).t();
-	result->_qtli = __orthog_cache.head_rows(A_n_rows).t() * __li_cache;
+	result->_nullspace = ws.orthog.row(A_n_rows).t();
+	result->_qtli = ws.orthog.head_rows(A_n_rows).t() * ws.li;
 	
 	return result;
 }
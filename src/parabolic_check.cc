@@ -16,74 +16,174 @@
  */
 #include "parabolic_check.h"
 
+#include <cmath>
+
 namespace ptope {
 namespace {
 constexpr double error = 1e-10;
 }
 /*
- * Currently uses stupid eigendecomposition way of determining whether
- * parabolic. Should instead use something like Cholesky or LDL.
+ * Each new row r of the factorisation is found by forward substitution. With
+ * u_j = (L D)_rj, each u_j = m_rj - sum_{i<j} u_i L_ji and L_rj = u_j / D_j,
+ * then the new pivot is D_r = m_rr - sum_j u_j L_rj.
+ *
+ * A positive semi-definite matrix can have zero pivots, in which case the
+ * whole of that column of its Schur complement is also zero. Such columns of
+ * L are set to zero, and a non-zero u_j shows that the matrix is indefinite.
  */
 bool
-ParabolicCheck::parabolic(const arma::mat & m) {
-	bool result = true;
-	if(std::abs(_det(m)) > error) {
-		result = false;
-	} else {
-		arma::eig_sym(_evalues, m);
-		for(arma::uword i = 0; result && i < m.n_rows; ++i) {
-			if (_evalues(i) < -error) {
-				result = false;
-			}
+ParabolicCheck::add_row(const arma::mat & m, const arma::uvec & indices,
+		arma::uword row, arma::uword first) {
+	double * new_col = _ldl.colptr(row);
+	const double * m_col = m.colptr(indices(row));
+	double pivot = m_col[indices(row)];
+	for(arma::uword j = 0; j < first; ++j) {
+		new_col[j] = 0;
+	}
+	for(arma::uword j = first; j < row; ++j) {
+		const double * l_col = _ldl.colptr(j);
+		double u = m_col[indices(j)];
+		for(arma::uword i = first; i < j; ++i) {
+			u -= _scaled(i) * l_col[i];
+		}
+		if(l_col[j] > error) {
+			_scaled(j) = u;
+			new_col[j] = u / l_col[j];
+			pivot -= u * new_col[j];
+		} else if(std::abs(u) > error) {
+			return false;
+		} else {
+			_scaled(j) = 0;
+			new_col[j] = 0;
 		}
 	}
-	return result;
+	new_col[row] = pivot;
+	return pivot >= -error;
 }
 bool
-ParabolicCheck::check_submatrices(arma::uvec & indices, arma::uword index,
-		const arma::mat & m) {
-	bool result = false;
-	if(index == indices.size() - 1) {
-		/* Have d-1 submatrix, so just add last column */
-		indices(indices.size() - 1) = m.n_cols - 1;
-		_submat_cache = m.submat(indices, indices);
-		result = parabolic(_submat_cache);
-	} else {
-		/* Keep adding to submatrix */
-		arma::uword min = (index == 0 ? 0 : indices(index - 1) + 1);
-		for(arma::uword k = min, max = m.n_cols - 1; !result && k < max; ++k) {
-			indices(index) = k;
-			result = check_submatrices(indices, index + 1, m);
+ParabolicCheck::singular(arma::uword size) const {
+	for(arma::uword i = 0; i < size; ++i) {
+		if(_ldl.at(i, i) <= error) {
+			return true;
 		}
 	}
-	return result;
+	return false;
 }
-double
-ParabolicCheck::UnsignedDet::operator()(const arma::mat & m) {
-	double val;
-	if(m.n_rows <= 4) {
-		val = arma::auxlib::det_tinymat(m, m.n_rows);
-	} else {
-		_copy = m;
-		_ipiv.set_min_size(_copy.n_rows);
-			
-		arma::blas_int info(0);
-		arma::blas_int n_rows(_copy.n_rows);
-		arma::blas_int n_cols(_copy.n_cols);
-			
-		/* getrf computes LU decomposition. ipiv returns info on any row
-		 * permutations (each of which would switch sign of det) */
-		arma::lapack::getrf(&n_rows, &n_cols, _copy.memptr(), &n_rows,
-				_ipiv.memptr(), &info);
-		if(info > 0) {
-			val = 0;
+/*
+ * Any submatrix containing the last vector splits into the connected
+ * component of that vector, and the remaining vectors which are orthogonal to
+ * the whole component. The components are enumerated as in the ESU algorithm:
+ * each new vector is taken from the extension set, which is then only grown by
+ * neighbours of that vector not already next to the component, so each
+ * connected set is found exactly once.
+ */
+bool
+ParabolicCheck::operator()(const arma::mat & m, const arma::uword & dim) {
+	arma::uword const last = m.n_cols - 1;
+	arma::uvec ind(dim);
+	_ldl.set_size(dim, dim);
+	_scaled.set_size(dim);
+	_classifier.set_gram(m);
+	_extensions.resize(dim + 1);
+	_orthogonal.resize(dim + 1);
+	ind(0) = last;
+	if(!add_row(m, ind, 0)) {
+		return false;
+	}
+	std::vector<arma::uword> & ext = _extensions[1];
+	std::vector<arma::uword> & orth = _orthogonal[1];
+	ext.clear();
+	orth.clear();
+	for(arma::uword u = 0; u < last; ++u) {
+		if(std::abs(m.at(u, last)) > error) {
+			ext.push_back(u);
 		} else {
-			val = _copy.at(0,0);
-			for(arma::uword i=1; i < _copy.n_rows; ++i){
-				val *= _copy.at(i,i);
+			orth.push_back(u);
+		}
+	}
+	return check_connected(ind, 1, m);
+}
+/*
+ * The factorisation of each prefix of indices is shared by all submatrices
+ * containing it, so each step of the recursion only adds a single row. Every
+ * principal submatrix of a positive semi-definite matrix is also positive
+ * semi-definite, so once a prefix is indefinite none of its extensions need
+ * to be checked.
+ *
+ * The vectors orthogonal to the component are exactly those which are neither
+ * in the component nor in its extension set, so adding w to the component
+ * moves the neighbours of w from the orthogonal vectors to the extension set.
+ */
+bool
+ParabolicCheck::check_connected(arma::uvec & indices, arma::uword size,
+		const arma::mat & m) {
+	if(size == indices.size()) {
+		return check_submatrix(indices);
+	}
+	std::vector<arma::uword> const& orth = _orthogonal[size];
+	if(check_orthogonal(indices, size, size, orth, 0, m)) {
+		return true;
+	}
+	std::vector<arma::uword> & ext = _extensions[size];
+	std::vector<arma::uword> & next_ext = _extensions[size + 1];
+	std::vector<arma::uword> & next_orth = _orthogonal[size + 1];
+	while(!ext.empty()) {
+		arma::uword const w = ext.back();
+		ext.pop_back();
+		indices(size) = w;
+		if(!add_row(m, indices, size)) {
+			continue;
+		}
+		next_ext = ext;
+		next_orth.clear();
+		for(const arma::uword u : orth) {
+			if(std::abs(m.at(u, w)) > error) {
+				next_ext.push_back(u);
+			} else {
+				next_orth.push_back(u);
 			}
 		}
+		if(check_connected(indices, size + 1, m)) {
+			return true;
+		}
+	}
+	return false;
+}
+bool
+ParabolicCheck::check_orthogonal(arma::uvec & indices, arma::uword size,
+		arma::uword index, const std::vector<arma::uword> & pool,
+		arma::uword start, const arma::mat & m) {
+	if(index == indices.size()) {
+		return check_submatrix(indices);
+	}
+	arma::uword const remaining = indices.size() - index;
+	for(arma::uword p = start; p + remaining <= pool.size(); ++p) {
+		indices(index) = pool[p];
+		if(add_row(m, indices, index, size)
+				&& check_orthogonal(indices, size, index + 1, pool, p + 1, m)) {
+			return true;
+		}
+	}
+	return false;
+}
+/*
+ * Every submatrix reaching this point has been factorised, and the pivots of a
+ * parabolic matrix are zero up to rounding, so only submatrices which appear
+ * singular are classified. The classifier is exact, so it overrides the
+ * numerical result whenever all the labels are known.
+ */
+bool
+ParabolicCheck::check_submatrix(const arma::uvec & indices) {
+	if(!singular(indices.size())) {
+		return false;
+	}
+	_class_indices.assign(indices.begin(), indices.end());
+	switch(_classifier.classify(_class_indices)) {
+		case EllipticClassifier::Result::Parabolic:
+		case EllipticClassifier::Result::Unknown:
+			return true;
+		default:
+			return false;
 	}
-	return val;
 }
 }
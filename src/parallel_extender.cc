@@ -0,0 +1,114 @@
+/*
+ * parallel_extender.cc
+ * Copyright 2015 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "parallel_extender.h"
+
+#include <algorithm>
+
+namespace ptope {
+ParallelExtender::ParallelExtender(const PolytopeCandidate & initial_polytope,
+		const Options & options)
+	:	_initial(initial_polytope),
+		_options(options),
+		_pruned(0),
+		_failed(false),
+		_emit_from(0) {
+	if(_options.grain == 0) {
+		_options.grain = 1;
+	}
+	/* The LQ decomposition is computed lazily, so compute it now to allow the
+	 * workers to copy the candidate concurrently. */
+	if(_initial.hyperbolic()) {
+		_initial.null_vector();
+	}
+}
+void
+ParallelExtender::run(ThreadPool & pool, const Sink & sink) {
+	const InnerProductVectors::Range & range = _options.extender.range;
+	/* The ranks are those of the domains used by each PolytopeExtender. */
+	const InnerProductVectors::Domains & domains = _options.extender.domains;
+	const std::size_t total = domains.empty()
+		? InnerProductVectors(_initial.real_dimension()).total()
+		: InnerProductVectors(domains).total();
+	const std::size_t end = std::min(range.end, total);
+	const std::size_t begin = std::min(range.begin, end);
+	_pruned = 0;
+	_failed = false;
+	_waiting.clear();
+	_emit_from = begin;
+	/* An empty range gives an extender which only sets up the enumeration. */
+	PolytopeExtender::Options opts = _options.extender;
+	opts.range = InnerProductVectors::Range(begin, begin);
+	const PolytopeExtender prototype(_initial, opts);
+	pool.submit([this, &pool, &sink, &prototype, begin, end](std::size_t) {
+				process(pool, sink, prototype, begin, end);
+			});
+	pool.wait();
+}
+void
+ParallelExtender::process(ThreadPool & pool, const Sink & sink,
+		const PolytopeExtender & prototype, std::size_t begin, std::size_t end) {
+	if(_failed) {
+		return;
+	}
+	try {
+		while(end - begin > _options.grain) {
+			const std::size_t mid = begin + (end - begin) / 2;
+			pool.submit([this, &pool, &sink, &prototype, mid, end](std::size_t) {
+						process(pool, sink, prototype, mid, end);
+					});
+			end = mid;
+		}
+		PolytopeExtender ext(prototype, InnerProductVectors::Range(begin, end));
+		Chunk chunk;
+		chunk.end = end;
+		while(ext.has_next()) {
+			chunk.results.push_back(ext.next());
+		}
+		_pruned += ext.pruned_subtrees();
+		deliver(sink, begin, std::move(chunk));
+	} catch(...) {
+		/* The pool passes the exception on to run. */
+		_failed = true;
+		throw;
+	}
+}
+/*
+ * The ranges handled by the tasks partition the whole range, so in order mode
+ * a chunk can be passed on as soon as every range before it has been.
+ */
+void
+ParallelExtender::deliver(const Sink & sink, std::size_t begin,
+		Chunk && chunk) {
+	std::lock_guard<std::mutex> lock(_sink_mutex);
+	if(!_options.ordered) {
+		for(const PolytopeCandidate & p : chunk.results) {
+			sink(p);
+		}
+		return;
+	}
+	_waiting.emplace(begin, std::move(chunk));
+	auto it = _waiting.find(_emit_from);
+	while(it != _waiting.end()) {
+		for(const PolytopeCandidate & p : it->second.results) {
+			sink(p);
+		}
+		_emit_from = it->second.end;
+		_waiting.erase(it);
+		it = _waiting.find(_emit_from);
+	}
+}
+}
@@ -21,10 +21,6 @@
 namespace ptope {
 namespace {
 constexpr double error = 10e-10;
-/* As the program is never run in parallel with shared resources, we can safely
- * cache these at a program/global level */
-arma::vec __new_vec_cached;
-arma::vec __null_vec_cached;
 }
 /* Static private vars */
 PolytopeCandidate PolytopeCandidate::InValid;
@@ -74,10 +70,39 @@ PolytopeCandidate::PolytopeCandidate(
 	_hyperbolic(false),
 	_valid(true) {}
 
+void
+PolytopeCandidate::assign(const double * gram_ptr, int gram_size, int gram_ld,
+		const double * vector_ptr, int vector_dim, int no_vectors) {
+	_gram.set_size(gram_size, gram_size);
+	for(int j = 0; j < gram_size; ++j) {
+		arma::arrayops::copy(_gram.colptr(j), gram_ptr + j * gram_ld, gram_size);
+	}
+	_vectors.assign(vector_ptr, vector_dim, no_vectors);
+	/* The basis is the first vector_dim - 1 vectors, with the last coordinate
+	 * negated as in rebase_vectors. */
+	const int n_basis = vector_dim - 1;
+	_basis_vecs_trans.set_size(n_basis, vector_dim);
+	for(int i = 0; i < n_basis; ++i) {
+		const double * v = vector_ptr + i * vector_dim;
+		for(int c = 0; c < n_basis; ++c) {
+			_basis_vecs_trans.at(i, c) = v[c];
+		}
+		_basis_vecs_trans.at(i, n_basis) = -v[n_basis];
+	}
+	_hyperbolic = true;
+	_valid = true;
+	_lq_info.reset();
+}
+PolytopeCandidate::Workspace &
+PolytopeCandidate::Workspace::local() {
+	static thread_local Workspace ws;
+	return ws;
+}
 PolytopeCandidate
 PolytopeCandidate::extend_by_inner_products(const arma::vec & inner_vector) const {
-	if(vector_from_inner_products(inner_vector)) {
-		return extend_by_vector(__new_vec_cached);
+	Workspace & ws = Workspace::local();
+	if(vector_from_inner_products(inner_vector, ws)) {
+		return extend_by_vector(ws.new_vec);
 	} else {
 		return PolytopeCandidate::InValid;
 	}
@@ -85,21 +110,28 @@ PolytopeCandidate::extend_by_inner_products(const arma::vec & inner_vector) cons
 bool
 PolytopeCandidate::extend_by_inner_products(PolytopeCandidate & result,
 		const arma::vec & inner_vector) const {
-	if(vector_from_inner_products(inner_vector)) {
-		extend_by_vector(result, __new_vec_cached);
+	return extend_by_inner_products(result, inner_vector, Workspace::local());
+}
+bool
+PolytopeCandidate::extend_by_inner_products(PolytopeCandidate & result,
+		const arma::vec & inner_vector, Workspace & ws) const {
+	if(vector_from_inner_products(inner_vector, ws)) {
+		extend_by_vector(result, ws.new_vec);
 		return true;
 	} else {
 		return false;
 	}
 }
 bool
-PolytopeCandidate::vector_from_inner_products(const arma::vec & inner_vector) const {
+PolytopeCandidate::vector_from_inner_products(const arma::vec & inner_vector,
+		Workspace & ws) const {
+	arma::vec & new_vec = ws.new_vec;
 	if(_hyperbolic) {
 		if(!_lq_info) {
-			_lq_info = detail::LQInfo::compute(_basis_vecs_trans);
+			_lq_info = detail::LQInfo::compute(_basis_vecs_trans, ws.lq);
 		}
-		__null_vec_cached = _lq_info->null();
-		__new_vec_cached = _lq_info->qtli() * inner_vector;
+		const arma::vec & null_vec = _lq_info->null();
+		new_vec = _lq_info->qtli() * inner_vector;
 		/* 
 		 * Rescale the new vector by adding something from the nullspace, so that
 		 * the norm of the vector is 1.
@@ -115,15 +147,15 @@ PolytopeCandidate::vector_from_inner_products(const arma::vec & inner_vector) co
 		 * which has solution:
 		 * 	l = (-<a,x> + sqrt( <a,x>*<a,x> + <a,a>(<x,x> - 1) ))/<a,a>
 		 */
-		const double xx = calc::mink_sq_norm(__new_vec_cached);
+		const double xx = calc::mink_sq_norm(new_vec);
 		if(std::abs(xx - 1.0) < error) {
 			/* Lapack solver returns a (Euclidean) unit vector. If the Minkowski norm
 			 * is also 1, then we have constructed a non-hyperbolic vector, which we
 			 * don't want. */
 			return false;
 		}
-		const double ax = calc::mink_inner_prod(__null_vec_cached, __new_vec_cached);
-		const double aa = calc::mink_sq_norm(__null_vec_cached);
+		const double ax = calc::mink_inner_prod(null_vec, new_vec);
+		const double aa = calc::mink_sq_norm(null_vec);
 		const double disc = ax * ax + aa * (1.0 - xx);
 		if(disc < 0) {
 			/* If discriminant is negative then no solutions */
@@ -144,10 +176,10 @@ PolytopeCandidate::vector_from_inner_products(const arma::vec & inner_vector) co
 					vec_ind < max && (plus || minus);
 					++vec_ind) {
 				const double * v = _vectors.get_ptr(vec_ind);
-				const double xv = calc::mink_inner_prod(__new_vec_cached.size(),
-						__new_vec_cached.memptr(), v);
-				const double av = calc::mink_inner_prod(__new_vec_cached.size(),
-						__null_vec_cached.memptr(), v);
+				const double xv = calc::mink_inner_prod(new_vec.size(),
+						new_vec.memptr(), v);
+				const double av = calc::mink_inner_prod(new_vec.size(),
+						null_vec.memptr(), v);
 				if(xv + lp * av > error) {
 					plus = false;
 				}
@@ -163,18 +195,229 @@ PolytopeCandidate::vector_from_inner_products(const arma::vec & inner_vector) co
 				return false;
 			}
 		}
-		__null_vec_cached *= l;
-		__new_vec_cached += __null_vec_cached;
+		new_vec += l * null_vec;
 	} else {
-		arma::solve(__new_vec_cached, _basis_vecs_trans, inner_vector);
-		const double e_norm = calc::eucl_sq_norm(__new_vec_cached);
+		arma::solve(new_vec, _basis_vecs_trans, inner_vector);
+		const double e_norm = calc::eucl_sq_norm(new_vec);
 		if(e_norm - 1.0 < error) {
 			/* Invalid set of angles. */
 			return false;
 		}
-		const arma::uword last_entry = __new_vec_cached.size();
-		__new_vec_cached.insert_rows(last_entry, 1, false);
-		__new_vec_cached(last_entry) = std::sqrt(e_norm - 1.0);
+		const arma::uword last_entry = new_vec.size();
+		new_vec.insert_rows(last_entry, 1, false);
+		new_vec(last_entry) = std::sqrt(e_norm - 1.0);
+	}
+	return true;
+}
+std::size_t
+PolytopeCandidate::extend_batch(const arma::mat & inner_products,
+		boost::dynamic_bitset<> & ok, arma::mat & new_vectors) const {
+	return extend_batch(inner_products, ok, new_vectors, Workspace::local());
+}
+/*
+ * This follows the same steps as vector_from_inner_products, but for a whole
+ * matrix of inner products at once. The unscaled vectors come from one GEMM,
+ * and the products of every new vector with every non-basis vector come from a
+ * second one, leaving only the cheap quadratic and sign tests for each column.
+ */
+std::size_t
+PolytopeCandidate::extend_batch(const arma::mat & inner_products,
+		boost::dynamic_bitset<> & ok, arma::mat & new_vectors,
+		Workspace & ws) const {
+	const arma::uword n_batch = inner_products.n_cols;
+	ok.resize(n_batch);
+	ok.reset();
+	std::size_t n_valid = 0;
+	if(_hyperbolic) {
+		if(!_lq_info) {
+			_lq_info = detail::LQInfo::compute(_basis_vecs_trans, ws.lq);
+		}
+		const arma::vec & null_vec = _lq_info->null();
+		const double * null_ptr = null_vec.memptr();
+		const arma::uword dim = null_vec.n_elem;
+		new_vectors = _lq_info->qtli() * inner_products;
+
+		const double aa = calc::mink_sq_norm(null_vec);
+		const bool null_is_time = std::abs(aa + 1) < error;
+		const arma::uword n_non_basis = _vectors.size() - inner_products.n_rows;
+		if(!null_is_time && n_non_basis > 0) {
+			/* Negating the last coordinate of the non-basis vectors turns their
+			 * Minkowski products into Euclidean ones. */
+			ws.batch_non_basis = _vectors.underlying_matrix().tail_cols(n_non_basis);
+			ws.batch_non_basis.row(dim - 1) *= -1;
+			ws.batch_products = ws.batch_non_basis.t() * new_vectors;
+			ws.batch_null_products = ws.batch_non_basis.t() * null_vec;
+		}
+		for(arma::uword col = 0; col < n_batch; ++col) {
+			double * x = new_vectors.colptr(col);
+			const double xx = calc::mink_inner_prod(dim, x, x);
+			if(std::abs(xx - 1.0) < error) {
+				continue;
+			}
+			const double ax = calc::mink_inner_prod(dim, null_ptr, x);
+			const double disc = ax * ax + aa * (1.0 - xx);
+			if(disc < 0) {
+				continue;
+			}
+			double l;
+			if(null_is_time) {
+				l = std::sqrt(disc);
+			} else {
+				const double lm = (-ax - std::sqrt(disc) )/aa;
+				const double lp = (-ax + std::sqrt(disc) )/aa;
+				bool plus = true;
+				bool minus = true;
+				for(arma::uword j = 0; j < n_non_basis && (plus || minus); ++j) {
+					const double xv = ws.batch_products.at(j, col);
+					const double av = ws.batch_null_products[j];
+					if(xv + lp * av > error) {
+						plus = false;
+					}
+					if(xv + lm * av > error) {
+						minus = false;
+					}
+				}
+				if(plus) {
+					l = lp;
+				} else if(minus) {
+					l = lm;
+				} else {
+					continue;
+				}
+			}
+			for(arma::uword i = 0; i < dim; ++i) {
+				x[i] += l * null_ptr[i];
+			}
+			ok.set(col);
+			++n_valid;
+		}
+	} else {
+		arma::solve(ws.batch_products, _basis_vecs_trans, inner_products);
+		const arma::uword dim = ws.batch_products.n_rows;
+		new_vectors.set_size(dim + 1, n_batch);
+		for(arma::uword col = 0; col < n_batch; ++col) {
+			const double * x = ws.batch_products.colptr(col);
+			const double e_norm = std::inner_product(x, x + dim, x,
+					static_cast<double>(0));
+			if(e_norm - 1.0 < error) {
+				continue;
+			}
+			double * out = new_vectors.colptr(col);
+			arma::arrayops::copy(out, x, dim);
+			out[dim] = std::sqrt(e_norm - 1.0);
+			ok.set(col);
+			++n_valid;
+		}
+	}
+	return n_valid;
+}
+PolytopeCandidate::Incremental::Incremental(const PolytopeCandidate & candidate)
+	:	_hyperbolic(candidate._hyperbolic),
+		_null_norm(0),
+		_xx(0),
+		_ax(0) {
+	if(_hyperbolic) {
+		_null = candidate.null_vector();
+		_solution = candidate._lq_info->qtli();
+		_null_norm = calc::mink_sq_norm(_null);
+		/* Negating the last row turns the Minkowski products into Euclidean ones,
+		 * so all products come from matrix products. */
+		arma::mat flipped(_solution);
+		flipped.row(flipped.n_rows - 1) *= -1;
+		_solution_prods = flipped.t() * _solution;
+		_null_prods = flipped.t() * _null;
+		const arma::uword n_non_basis = candidate._vectors.size() - _solution.n_cols;
+		arma::mat non_basis =
+			candidate._vectors.underlying_matrix().tail_cols(n_non_basis);
+		non_basis.row(non_basis.n_rows - 1) *= -1;
+		_non_basis_prods = non_basis.t() * _solution;
+		_non_basis_null = non_basis.t() * _null;
+	} else {
+		_solution = arma::inv(candidate._basis_vecs_trans);
+		_solution_prods = _solution.t() * _solution;
+	}
+}
+void
+PolytopeCandidate::Incremental::reset(const arma::vec & inner_products) {
+	_x = _solution * inner_products;
+	_x_prods = _solution_prods * inner_products;
+	_xx = arma::dot(inner_products, _x_prods);
+	if(_hyperbolic) {
+		_ax = arma::dot(_null_prods, inner_products);
+		_x_non_basis = _non_basis_prods * inner_products;
+	}
+}
+void
+PolytopeCandidate::Incremental::update(arma::uword index, double delta) {
+	const double * sol_col = _solution.colptr(index);
+	for(arma::uword i = 0, max = _x.n_elem; i < max; ++i) {
+		_x[i] += delta * sol_col[i];
+	}
+	/* <x + dc, x + dc> = <x,x> + 2d<x,c> + d^2<c,c> */
+	_xx += delta * (2 * _x_prods[index] + delta * _solution_prods.at(index, index));
+	const double * prods_col = _solution_prods.colptr(index);
+	for(arma::uword i = 0, max = _x_prods.n_elem; i < max; ++i) {
+		_x_prods[i] += delta * prods_col[i];
+	}
+	if(_hyperbolic) {
+		_ax += delta * _null_prods[index];
+		const double * non_basis_col = _non_basis_prods.colptr(index);
+		for(arma::uword j = 0, max = _x_non_basis.n_elem; j < max; ++j) {
+			_x_non_basis[j] += delta * non_basis_col[j];
+		}
+	}
+}
+/* See vector_from_inner_products for details. */
+bool
+PolytopeCandidate::Incremental::compute() {
+	const arma::uword dim = _x.n_elem;
+	if(_hyperbolic) {
+		if(std::abs(_xx - 1.0) < error) {
+			return false;
+		}
+		const double aa = _null_norm;
+		const double disc = _ax * _ax + aa * (1.0 - _xx);
+		if(disc < 0) {
+			return false;
+		}
+		double l;
+		if(std::abs(aa + 1) < error) {
+			l = std::sqrt(disc);
+		} else {
+			const double lm = (-_ax - std::sqrt(disc) )/aa;
+			const double lp = (-_ax + std::sqrt(disc) )/aa;
+			bool plus = true;
+			bool minus = true;
+			for(arma::uword j = 0, max = _x_non_basis.n_elem;
+					j < max && (plus || minus); ++j) {
+				const double xv = _x_non_basis[j];
+				const double av = _non_basis_null[j];
+				if(xv + lp * av > error) {
+					plus = false;
+				}
+				if(xv + lm * av > error) {
+					minus = false;
+				}
+			}
+			if(plus) {
+				l = lp;
+			} else if(minus) {
+				l = lm;
+			} else {
+				return false;
+			}
+		}
+		_new_vec.set_size(dim);
+		for(arma::uword i = 0; i < dim; ++i) {
+			_new_vec[i] = _x[i] + l * _null[i];
+		}
+	} else {
+		if(_xx - 1.0 < error) {
+			return false;
+		}
+		_new_vec.set_size(dim + 1);
+		arma::arrayops::copy(_new_vec.memptr(), _x.memptr(), dim);
+		_new_vec[dim] = std::sqrt(_xx - 1.0);
 	}
 	return true;
 }
@@ -211,6 +454,23 @@ PolytopeCandidate::extend_by_vector(PolytopeCandidate & result,
 	}
 	result._gram.at(last_row, last_col) = calc::mink_sq_norm(new_vec);
 }
+std::size_t
+PolytopeCandidate::dotted_edges(const arma::vec & new_vec) const {
+	std::size_t count = 0;
+	for(arma::uword i = 0, max = _vectors.size(); i < max; ++i) {
+		/* Before extending into hyperbolic space the new vector has an extra
+		 * coordinate, which is zero in every existing vector. */
+		const double val = _hyperbolic ?
+			calc::mink_inner_prod(new_vec.size(), new_vec.memptr(),
+					_vectors.get_ptr(i)) :
+			calc::eucl_inner_prod(new_vec.size() - 1, new_vec.memptr(),
+					_vectors.get_ptr(i));
+		if(calc::is_dotted(val)) {
+			++count;
+		}
+	}
+	return count;
+}
 void
 PolytopeCandidate::rebase_vectors(arma::uvec vec_indices) {
 	std::sort(vec_indices.begin(), vec_indices.end());
@@ -252,6 +512,13 @@ PolytopeCandidate::signature() const {
 	}
 	return result;
 }
+const arma::vec &
+PolytopeCandidate::null_vector() const {
+	if(!_lq_info) {
+		_lq_info = detail::LQInfo::compute(_basis_vecs_trans);
+	}
+	return _lq_info->null();
+}
 std::size_t
 PolytopeCandidate::real_dimension() const {
 	if(_hyperbolic) {
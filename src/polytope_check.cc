@@ -16,12 +16,77 @@
  */
 #include "polytope_check.h"
 
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+#include "fixed_cholesky.h"
+
 namespace ptope {
+namespace {
+/** Number of edges searched by each task of a parallel batch. */
+constexpr std::size_t batch_grain = 16;
+/**
+ * Progress through the chunks of a parallel batch. Shared with the tasks
+ * submitted to the pool, as a task may only start once every chunk has been
+ * taken and the check has moved on.
+ */
+struct BatchProgress {
+	explicit BatchProgress(std::size_t chunks)
+		: next(0), n_chunks(chunks), done(0) {}
+	std::atomic<std::size_t> next;
+	std::size_t const n_chunks;
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::size_t done;
+};
+}
 PolytopeCheck::PolytopeCheck()
-	: _visited_vertices( 0, 0 )
+	: _faces_1()
+	, _faces_2()
+	, _faces_4()
+	, _faces_16()
 	, _edge_queue{}
+	, _workspace()
+	, _pool(nullptr)
+	, _min_batch(default_min_batch)
+	, _screen_margin(BatchCholesky::default_screen_margin)
+	, _adjacency_filter(true)
+	, _workers()
+	, _workers_ready(false)
+	, _batch()
+	, _batch_ends()
 	, m_dimension{ 0 }
+	, _stats()
 {}
+constexpr std::size_t PolytopeCheck::max_facets;
+constexpr std::size_t PolytopeCheck::default_min_batch;
+void
+PolytopeCheck::set_thread_pool(ThreadPool * pool, std::size_t min_batch) {
+	_pool = pool;
+	_min_batch = std::max<std::size_t>(min_batch, 1);
+	_workers.clear();
+	if(_pool != nullptr) {
+		_workers.resize(_pool->size());
+		for(Workspace & ws : _workers) {
+			ws.batch.set_screen_margin(_screen_margin);
+		}
+	}
+}
+void
+PolytopeCheck::set_screen_margin(float margin) {
+	_screen_margin = margin;
+	_workspace.batch.set_screen_margin(margin);
+	for(Workspace & ws : _workers) {
+		ws.batch.set_screen_margin(margin);
+	}
+}
+void
+PolytopeCheck::set_adjacency_filter(bool filter) {
+	_adjacency_filter = filter;
+}
 /*
  * The Gram matrix of a polytope contains all the information to determine
  * whether or not it is compact - which is really what this method is checking.
@@ -50,97 +115,443 @@ PolytopeCheck::PolytopeCheck()
  * Eventually either all edges have been checked and found to contain two
  * vertices so the matrix is a polytope, or one edge will be found to only
  * contain one vertex so the matrix is not a polytope.
+ *
+ * Each edge is added to the queue from both of its vertices, so once an edge
+ * has been found to contain two vertices it is remembered and not searched
+ * again.
+ *
+ * Whether a submatrix is elliptic only depends on its Coxeter diagram, so when
+ * all its entries are known angles the EllipticClassifier decides this exactly
+ * without any factorisation.
  */
 bool
 PolytopeCheck::operator()(PolytopeCandidate const& p) {
-	static vector_t s_vertex;
+	return priv_dispatch(p, nullptr, nullptr);
+}
+bool
+PolytopeCheck::operator()(PolytopeCandidate const& p, State & state) {
+	return priv_dispatch(p, nullptr, &state);
+}
+bool
+PolytopeCheck::check_extension(PolytopeCandidate const& p,
+		State const& parent) {
+	return priv_dispatch(p, &parent, nullptr);
+}
+bool
+PolytopeCheck::check_extension(PolytopeCandidate const& p,
+		State const& parent, State & state) {
+	return priv_dispatch(p, &parent, &state);
+}
+bool
+PolytopeCheck::priv_dispatch(PolytopeCandidate const& p, State const* parent,
+		State * state) {
+	_stats = Stats();
+	_workspace.stats = Stats();
+	for(Workspace & ws : _workers) {
+		ws.stats = Stats();
+	}
+	_workers_ready = false;
+	arma::uword const n_facets = p.gram().n_cols;
+	if(n_facets <= FacetMask<1>::max_facets) {
+		return priv_check(p, _faces_1, parent, state);
+	} else if(n_facets <= FacetMask<2>::max_facets) {
+		return priv_check(p, _faces_2, parent, state);
+	} else if(n_facets <= FacetMask<4>::max_facets) {
+		return priv_check(p, _faces_4, parent, state);
+	} else if(n_facets <= FacetMask<16>::max_facets) {
+		return priv_check(p, _faces_16, parent, state);
+	}
+	if(state != nullptr) {
+		state->_valid = false;
+	}
+	return false;
+}
+/*
+ * The entries are compared exactly, as extending a candidate copies its gram
+ * matrix unchanged.
+ */
+bool
+PolytopeCheck::State::extended_by(arma::mat const& gram,
+		vector_index_t dimension) const {
+	if(!_valid || _dimension != dimension || _n_facets + 1 != gram.n_cols) {
+		return false;
+	}
+	for(arma::uword j = 0; j < _n_facets; ++j) {
+		double const * col = gram.colptr(j);
+		double const * parent_col = _gram.colptr(j);
+		for(arma::uword i = 0; i <= j; ++i) {
+			if(col[i] != parent_col[i]) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+template <std::size_t Words>
+bool
+PolytopeCheck::priv_check(PolytopeCandidate const& p, Faces<Words>& faces,
+		State const* parent, State * state) {
+	FacetMaskSet<Words>& visited = faces.vertices;
+	FacetMask<Words> vertex;
 
-	_visited_vertices.clear();
-	while(!_edge_queue.empty()) _edge_queue.pop();
-	if( m_dimension != p.real_dimension() ) {
-		m_dimension = p.real_dimension();
-		_visited_vertices = VectorSet<vector_elem_t>( m_dimension );
+	visited.clear();
+	faces.closed_edges.clear();
+	arma::mat const& gram = p.gram();
+	arma::uword const n_facets = gram.n_cols;
+	faces.adjacent.assign(n_facets, FacetMask<Words>());
+	for(arma::uword j = 0; j < n_facets; ++j) {
+		double const * col = gram.colptr(j);
+		for(arma::uword i = 0; i < j; ++i) {
+			if(col[i] > -1.0 || !_adjacency_filter) {
+				faces.adjacent[i].set(j);
+				faces.adjacent[j].set(i);
+			}
+		}
 	}
+	while(!_edge_queue.empty()) _edge_queue.pop();
+	m_dimension = p.real_dimension();
+	_workspace.classifier.set_gram(gram);
 
-	initial_vertex(p, s_vertex);
-	_visited_vertices.add(s_vertex);
-	for(vector_index_t i = 0, max = s_vertex.size(); i < max; ++i) {
-		_edge_queue.emplace( 0, i );
+	// Facets below this were already tried on the next edge by the parent.
+	vector_index_t first_facet = 0;
+	if(parent != nullptr && parent->extended_by(gram, m_dimension)) {
+		for(State::Mask const& mask : parent->_vertices) {
+			visited.add(FacetMask<Words>(mask));
+		}
+		for(State::Mask const& mask : parent->_closed_edges) {
+			faces.closed_edges.add(FacetMask<Words>(mask));
+		}
+		for(Edge const& edge : parent->_edges) {
+			_edge_queue.push(edge);
+		}
+		if(!parent->_compact) {
+			first_facet = parent->_n_facets;
+		}
+	} else {
+		initial_vertex(p, vertex);
+		if(vertex.count() != m_dimension) {
+			// Without a vertex to start from there are no edges to search.
+			if(state != nullptr) {
+				state->_valid = false;
+			}
+			return false;
+		}
+		visited.add(vertex);
+		add_edges_from_vertex(vertex, 0, no_vertex);
 	}
 
-	arma::mat const& gram = p.gram();
 	bool result = true;
 	while(result && !_edge_queue.empty()) {
+		if(_pool != nullptr && first_facet == 0
+				&& _edge_queue.size() >= _min_batch) {
+			result = priv_search_batch(gram, faces, state);
+			continue;
+		}
 		Edge edge = _edge_queue.front();
 		_edge_queue.pop();
-		vector_elem_t const next_vert_ind = priv_edge_end(edge, gram, s_vertex);
+		FacetMask<Words> const edge_mask =
+			visited.at( edge.vertex ).without( edge.removed );
+		if(faces.closed_edges.contains(edge_mask)) {
+			++_workspace.stats.potrf_saved;
+			continue;
+		}
+		vector_elem_t const next_vert_ind = priv_edge_end(edge, gram, faces,
+				vertex, first_facet, _workspace);
+		first_facet = 0;
 		if(next_vert_ind == no_vertex) {
 			result =  false;
+			if(state != nullptr) {
+				state->_edges.clear();
+				state->_edges.push_back(edge);
+			}
 		} else {
-			if(_visited_vertices.add(s_vertex)) {
-				vertex_index_t inserted_index = _visited_vertices.size() - 1;
-				add_edges_from_vertex(s_vertex, inserted_index, next_vert_ind);
+			faces.closed_edges.add(edge_mask);
+			if(visited.add(vertex)) {
+				vertex_index_t inserted_index = visited.size() - 1;
+				add_edges_from_vertex(vertex, inserted_index, next_vert_ind);
 			}
 		}
 	}
+	_stats += _workspace.stats;
+	for(Workspace const& ws : _workers) {
+		_stats += ws.stats;
+	}
+	_stats.vertices = visited.size();
+	if(state != nullptr) {
+		state->_valid = true;
+		state->_compact = result;
+		state->_n_facets = n_facets;
+		state->_dimension = m_dimension;
+		state->_gram = gram;
+		state->_vertices.clear();
+		for(std::size_t i = 0, max = visited.size(); i < max; ++i) {
+			state->_vertices.emplace_back(visited.at(i));
+		}
+		state->_closed_edges.clear();
+		for(std::size_t i = 0, max = faces.closed_edges.size(); i < max; ++i) {
+			state->_closed_edges.emplace_back(faces.closed_edges.at(i));
+		}
+		if(result) {
+			state->_edges.clear();
+		}
+		for(; !_edge_queue.empty(); _edge_queue.pop()) {
+			state->_edges.push_back(_edge_queue.front());
+		}
+	}
 	return result;
 }
+/*
+ * The edges waiting in the queue only depend on the vertices found so far, so
+ * can all be searched at once. Each edge is searched without changing the
+ * faces found, and only afterwards are the vertices added, in the order the
+ * serial search would add them. This gives the same vertices and result as the
+ * serial search.
+ *
+ * The calling thread works through the chunks of the batch alongside the
+ * pool, so that a check run from within a task of the same pool still makes
+ * progress if every other thread is busy.
+ */
+template <std::size_t Words>
+bool
+PolytopeCheck::priv_search_batch(arma::mat const& gram, Faces<Words>& faces,
+		State * state) {
+	FacetMaskSet<Words>& visited = faces.vertices;
+	_batch.clear();
+	for(; !_edge_queue.empty(); _edge_queue.pop()) {
+		Edge const& edge = _edge_queue.front();
+		if(faces.closed_edges.contains(
+					visited.at( edge.vertex ).without( edge.removed ))) {
+			++_workspace.stats.potrf_saved;
+		} else {
+			_batch.push_back(edge);
+		}
+	}
+	std::size_t const size = _batch.size();
+	_batch_ends.resize(size);
+	faces.batch_vertices.resize(size);
+	if(!_workers_ready) {
+		for(Workspace & ws : _workers) {
+			ws.classifier = _workspace.classifier;
+		}
+		_workers_ready = true;
+	}
+
+	std::size_t const n_chunks = (size + batch_grain - 1) / batch_grain;
+	std::shared_ptr<BatchProgress> progress =
+		std::make_shared<BatchProgress>(n_chunks);
+	std::size_t const caller = _workers.size();
+	// Nothing but the progress is touched until a chunk has been taken, as the
+	// check may have finished by the time a task starts.
+	auto run_chunks = [this, &gram, &faces, size, caller](BatchProgress & prog,
+			std::size_t worker) {
+		std::size_t chunk;
+		while((chunk = prog.next++) < prog.n_chunks) {
+			Workspace & ws = (worker == caller) ? _workspace : _workers[worker];
+			std::size_t const begin = chunk * batch_grain;
+			priv_search_chunk(ws, gram, faces, begin,
+					std::min(begin + batch_grain, size));
+			std::lock_guard<std::mutex> lock(prog.mutex);
+			if(++prog.done == prog.n_chunks) {
+				prog.cv.notify_all();
+			}
+		}
+	};
+	for(std::size_t i = 1, max = std::min(_workers.size() + 1, n_chunks);
+			i < max; ++i) {
+		_pool->submit([progress, run_chunks](std::size_t worker) {
+					run_chunks(*progress, worker);
+				});
+	}
+	run_chunks(*progress, caller);
+	{
+		std::unique_lock<std::mutex> lock(progress->mutex);
+		progress->cv.wait(lock,
+				[&progress]() { return progress->done == progress->n_chunks; });
+	}
+
+	for(std::size_t k = 0; k < size; ++k) {
+		Edge const& edge = _batch[k];
+		FacetMask<Words> const edge_mask =
+			visited.at( edge.vertex ).without( edge.removed );
+		if(faces.closed_edges.contains(edge_mask)) {
+			++_workspace.stats.potrf_saved;
+			continue;
+		}
+		if(_batch_ends[k] == no_vertex) {
+			if(state != nullptr) {
+				state->_edges.assign(_batch.begin() + k, _batch.end());
+			}
+			return false;
+		}
+		faces.closed_edges.add(edge_mask);
+		if(visited.add(faces.batch_vertices[k])) {
+			vertex_index_t inserted_index = visited.size() - 1;
+			add_edges_from_vertex(faces.batch_vertices[k], inserted_index,
+					_batch_ends[k]);
+		}
+	}
+	return true;
+}
+template <std::size_t Words>
+void
+PolytopeCheck::priv_search_chunk(Workspace & ws, arma::mat const& gram,
+		Faces<Words>& faces, std::size_t begin, std::size_t end) {
+	for(std::size_t k = begin; k < end; ++k) {
+		_batch_ends[k] = priv_edge_end(_batch[k], gram, faces,
+				faces.batch_vertices[k], 0, ws);
+	}
+}
+template <std::size_t Words>
 PolytopeCheck::vector_elem_t
 PolytopeCheck::priv_edge_end( Edge const& edge, arma::mat const& gram,
-		vector_t& vertex_out ) const {
-	static arma::mat s_vertex_submat;
-	static vector_t s_indices;
-
+		Faces<Words> const& faces, FacetMask<Words>& vertex_out,
+		vector_index_t first_facet, Workspace & ws ) const {
 	arma::uword const edge_size = m_dimension - 1;
-	arma::uword const vertex_size = m_dimension;
-
-	s_indices.set_size(vertex_size);
-	s_vertex_submat.set_size(vertex_size, vertex_size);
-
-	vector_elem_t const * old_vertex_ptr = _visited_vertices.ptr_at( edge.vertex );
-	arma::arrayops::copy( s_indices.memptr(), old_vertex_ptr, edge.removed );
-	arma::arrayops::copy( s_indices.memptr() + edge.removed,
-			old_vertex_ptr + edge.removed + 1, edge_size - edge.removed );
 
-	// Construct the vertex submatrix, which later we will check to see if it is
-	// elliptic. As the elliptic check knows the matrix is symmetric, it only ever
-	// references the upper triangle of the matrix. Only setting this saves a
-	// bunch of memory copies.
-	priv_copy_upper_triangle_submat( s_vertex_submat.memptr(), gram.memptr(),
-			s_indices, edge_size, vertex_size, gram.n_rows );
+	ws.indices.set_size(edge_size);
+	ws.edge_chol.set_size(edge_size, edge_size);
+	ws.schur_tmp.set_size(edge_size);
 
-	arma::uword const last_entry = edge_size;
-	vector_elem_t const removed_value = old_vertex_ptr[ edge.removed ];
-
-	auto edge_begin = s_indices.begin();
-	auto edge_end = s_indices.end() - 1;
-	for(vector_elem_t i = 0, max = gram.n_cols; i < max; ++i) {
-		if(i == removed_value) { continue; }
-		// Each edge is sorted, so a binary search is better than std::find
-		if( !std::binary_search(edge_begin, edge_end, i) ) {
-			priv_vertex_from_edge( edge, i, vertex_out );
-			if( _visited_vertices.contains( vertex_out )) { return i; }
-			s_indices[last_entry] = i;
-			priv_copy_submat_col( s_vertex_submat.colptr( last_entry ),
-					gram.colptr( i ), s_indices, vertex_size );
+	FacetMaskSet<Words> const& visited = faces.vertices;
+	FacetMask<Words> const& old_vertex = visited.at( edge.vertex );
+	FacetMask<Words> const edge_mask = old_vertex.without( edge.removed );
+	// Only facets which could share a vertex with all the edge's facets need to
+	// be checked.
+	FacetMask<Words> candidates;
+	for(arma::uword i = first_facet, max = gram.n_cols; i < max; ++i) {
+		candidates.set(i);
+	}
+	vector_index_t index = 0;
+	edge_mask.for_each([&index, &candidates, &faces, &ws](std::size_t facet) {
+			ws.indices[index++] = facet;
+			candidates &= faces.adjacent[facet];
+		});
+	candidates.remove(old_vertex);
+	++ws.stats.edges_searched;
+	if(candidates.none()) {
+		return no_vertex;
+	}
+	// The facets of each possible vertex are the edge's facets, followed by the
+	// candidate facet in the last position.
+	ws.vertex_indices.assign(ws.indices.begin(), ws.indices.end());
+	ws.vertex_indices.push_back(0);
 
-			if(is_elliptic(s_vertex_submat)) {
-				return i;
+	// Every possible vertex along the edge contains the edge submatrix, so this
+	// is factored at most once, and only when some vertex cannot be classified.
+	// The first such vertex is usually elliptic, so is checked on its own. Any
+	// later ones are checked in batches which share the edge's factor, and the
+	// first found to be elliptic is kept.
+	bool edge_factored = false;
+	bool batch_started = false;
+	ws.batch_facets.clear();
+	auto run_batch = [&ws]() -> vector_elem_t {
+		ws.batch.run();
+		ws.stats.screened += ws.batch.screened();
+		ws.stats.screen_ambiguous += ws.batch.ambiguous();
+		vector_elem_t result = no_vertex;
+		for(std::size_t k = 0, max = ws.batch.size(); k < max; ++k) {
+			if(ws.batch.positive_definite(k)) {
+				result = ws.batch_facets[k];
+				break;
+			}
+		}
+		ws.batch.clear();
+		ws.batch_facets.clear();
+		return result;
+	};
+	vector_elem_t found = no_vertex;
+	// The batches start small and grow, which bounds the work wasted on
+	// vertices after the one found. Only the largest are screened in single
+	// precision.
+	std::size_t batch_limit = 2;
+	while(found == no_vertex && !candidates.none()) {
+		vector_elem_t const i = candidates.first();
+		candidates.reset(i);
+		if( visited.contains( edge_mask.with(i) )) {
+			found = i;
+			break;
+		}
+		ws.vertex_indices.back() = i;
+		EllipticClassifier::Result const result =
+			ws.classifier.classify(ws.vertex_indices);
+		if(result != EllipticClassifier::Result::Unknown) {
+			++ws.stats.classified;
+			if(result == EllipticClassifier::Result::Elliptic) {
+				found = i;
+			}
+			continue;
+		}
+		if(!edge_factored) {
+			// With the facets ordered by component the edge submatrix is block
+			// diagonal, and so is its cholesky factor, so each block is factored
+			// on its own. As potrf only references the upper triangle of the
+			// matrix, only that part is copied.
+			std::size_t const n_blocks = ws.blocks.decompose(gram, ws.indices);
+			index = 0;
+			for(std::size_t b = 0; b < n_blocks; ++b) {
+				for(const arma::uword facet : ws.blocks.component(b)) {
+					ws.indices[index++] = facet;
+				}
+			}
+			priv_copy_upper_triangle_submat( ws.edge_chol.memptr(), gram.memptr(),
+					ws.indices, edge_size, edge_size, gram.n_rows );
+			++ws.stats.potrf_calls;
+			arma::uword start = 0;
+			for(std::size_t b = 0; b < n_blocks; ++b) {
+				arma::uword const block_size = ws.blocks.component(b).size();
+				if(!priv_chol_in_place(ws.edge_chol, start, block_size)) {
+					// The edge is not elliptic, so no vertex can contain it.
+					return no_vertex;
+				}
+				start += block_size;
 			}
+			edge_factored = true;
+			priv_copy_submat_col( ws.schur_tmp.memptr(), gram.colptr( i ), ws.indices,
+					edge_size );
+			if(priv_schur_positive(ws.edge_chol, ws.schur_tmp.memptr(),
+						gram.at(i, i))) {
+				found = i;
+			}
+			continue;
+		}
+		if(!batch_started) {
+			ws.batch_indices.assign(ws.indices.begin(), ws.indices.end());
+			ws.batch_indices.push_back(0);
+			ws.batch.reset(m_dimension, ws.edge_chol, edge_size);
+			batch_started = true;
+		}
+		ws.batch_indices.back() = i;
+		ws.batch.add(gram, ws.batch_indices);
+		ws.batch_facets.push_back(i);
+		if(ws.batch_facets.size() == batch_limit) {
+			found = run_batch();
+			batch_limit = std::min(2 * batch_limit, BatchCholesky::screen_lanes);
+		}
+	}
+	// Any vertices still waiting come before the one found, so take priority.
+	if(!ws.batch_facets.empty()) {
+		vector_elem_t const numeric = run_batch();
+		if(numeric != no_vertex) {
+			found = numeric;
 		}
 	}
-	return no_vertex;
+	if(found != no_vertex) {
+		vertex_out = edge_mask.with(found);
+	}
+	return found;
 }
 /* The initial vertex could be any elliptic subdiagram, however the way
  * PolytopeCandidates are constructed mean that the initial gram matrix would be
  * a good choice. The vectors corresponding to this matrix all have zeros in the
  * final coordinate, while any other vectors cannot. Hence this comes down to a
  * search for the vectors which have this zero. */
+template <std::size_t Words>
 void
-PolytopeCheck::initial_vertex(const PolytopeCandidate & p, vector_t& output) const {
+PolytopeCheck::initial_vertex(const PolytopeCandidate & p,
+		FacetMask<Words>& output) const {
 	VectorFamily const& vf = p.vector_family();
 	vector_index_t const last_val = p.real_dimension();
-	output.set_size( last_val );
+	output = FacetMask<Words>();
 
 	vector_index_t result_ind = 0;
 	for(arma::uword i = 0, max = vf.size();
@@ -148,44 +559,54 @@ PolytopeCheck::initial_vertex(const PolytopeCandidate & p, vector_t& output) con
 			++i) {
 		auto vector = vf.get_ptr(i);
 		if(vector[last_val] == 0) {
-			output(result_ind) = i;
+			output.set(i);
 			++result_ind;
 		}
 	}
 }
+template <std::size_t Words>
 void
-PolytopeCheck::priv_vertex_from_edge(Edge const& edge,
-			vector_elem_t const vertex_index, vector_t& output) const {
-	vector_index_t const edge_size = m_dimension - 1;
-
-	// Copy the old vertex into the new one, missing out the removed entry.
-	vector_elem_t const * old_vert_ptr = _visited_vertices.ptr_at( edge.vertex );
-	arma::arrayops::copy( output.memptr(), old_vert_ptr, edge.removed );
-	arma::arrayops::copy( output.memptr() + edge.removed,
-			old_vert_ptr + edge.removed + 1, edge_size - edge.removed );
-	output(edge_size) = vertex_index;
-
-	// Use rotate to move the inserted last value into the right/sorted position.
-	// upper_bound gives the place to insert the value.
-	auto last_edge_entry = output.end() - 1;
-	auto insert_place = std::upper_bound( output.begin(), last_edge_entry, vertex_index );
-	std::rotate( insert_place , last_edge_entry, output.end() );
-}
-/* Simplifies what arma::chol computes. The upper triangle of
- * __elliptic_check_tmp will contain the actual cholesky decomp of mat. The
- * lower triangle contains junk that would otherwise be set to 0. We don't
- * actually care about the cholesky result here, just whether it can be
- * computed. */
+PolytopeCheck::add_edges_from_vertex(FacetMask<Words> const& vertex,
+		vertex_index_t const vertex_ind, vector_elem_t const exclude) {
+	vertex.for_each([this, vertex_ind, exclude](std::size_t facet) {
+			if(facet != exclude) {
+				_edge_queue.emplace( vertex_ind, facet );
+			}
+		});
+}
 bool
-PolytopeCheck::priv_has_chol(arma::mat const& mat, arma::blas_int nrows,
-		arma::blas_int ldmat) const {
-	static arma::podarray<double> s_elliptic_check_tmp;
-	s_elliptic_check_tmp.set_min_size( nrows * ldmat );
-	arma::arrayops::copy( s_elliptic_check_tmp.memptr(), mat.memptr(), nrows * ldmat );
-	static char uplo = 'U';
+PolytopeCheck::priv_chol_in_place(arma::mat & mat, arma::uword start,
+		arma::uword size) const {
+	if(size == 0) {
+		return true;
+	}
+	if(size <= fixed_cholesky::max_size) {
+		return fixed_cholesky::chol_in_place(&mat.at(start, start), size,
+				mat.n_rows);
+	}
+	char uplo = 'U';
+	arma::blas_int n = size;
+	arma::blas_int lda = mat.n_rows;
 	arma::blas_int info = 0;
-	arma::lapack::potrf(&uplo, &nrows, s_elliptic_check_tmp.memptr(), &ldmat, &info);
+	arma::lapack::potrf(&uplo, &n, &mat.at(start, start), &lda, &info);
 	return (info == 0);
 }
+bool
+PolytopeCheck::priv_schur_positive(arma::mat const& chol, double * col,
+		double diag) const {
+	return fixed_cholesky::schur_positive(chol.memptr(), chol.n_rows,
+			chol.n_rows, col, diag);
+}
+/* Only whether the cholesky decomposition of the leading nrows x nrows block
+ * of mat can be computed matters, not the decomposition itself. */
+bool
+PolytopeCheck::priv_has_chol(arma::mat const& mat, arma::blas_int nrows,
+		arma::blas_int ldmat) {
+	BatchCholesky & batch = _workspace.batch;
+	batch.reset(nrows);
+	batch.add(mat.memptr(), ldmat);
+	batch.run();
+	return batch.positive_definite(0);
+}
 }
 
@@ -17,17 +17,80 @@
 #include "polytope_extender.h"
 
 namespace ptope {
-PolytopeExtender::PolytopeExtender(const PolytopeCandidate & initial_polytope)
+namespace {
+constexpr arma::uword batch_size = 256;
+/* Number of Gray code steps between recomputing the vector from scratch, to
+ * stop rounding errors building up in the incremental updates. */
+constexpr std::size_t gray_resync = 1024;
+InnerProductVectors
+make_vectors(const PolytopeCandidate & initial,
+		const PolytopeExtender::Options & options) {
+	const InnerProductVectors::Domains domains = options.domains.empty() ?
+		InnerProductVectors::default_domains(initial.real_dimension()) :
+		options.domains;
+	const InnerProductVectors::Order order = options.gray_code
+		? InnerProductVectors::Order::Gray
+		: InnerProductVectors::Order::Lexicographic;
+	if(options.prune || options.symmetry) {
+		return InnerProductVectors(initial, domains, options.range, options.prune,
+				options.symmetry, options.dotted, options.angles, order);
+	} else {
+		return InnerProductVectors(domains, options.range, order);
+	}
+}
+}
+PolytopeExtender::PolytopeExtender(const PolytopeCandidate & initial_polytope,
+		const Options & options)
 	:	_initial(initial_polytope),
-		_inner_product_vectors(_initial.real_dimension()),
-		_computed_next(false) {
+		_inner_product_vectors(make_vectors(_initial, options)),
+		_computed_next(false),
+		_batch_pos(boost::dynamic_bitset<>::npos),
+		_gray_code(options.gray_code),
+		_incremental(_gray_code ? PolytopeCandidate::Incremental(_initial)
+				: PolytopeCandidate::Incremental()),
+		_gray_steps(0),
+		_gray_last(),
+		_dotted(options.dotted),
+		_angles(options.angles),
+		_angle_check(),
+		_next_rank(_inner_product_vectors.rank()),
+		_resume_rank(_next_rank) {
 	/* Need this call to ensure that the iterator is initialized properly */
 	has_next();
 }
-PolytopeExtender::PolytopeExtender(PolytopeCandidate && initial_polytope)
+PolytopeExtender::PolytopeExtender(PolytopeCandidate && initial_polytope,
+		const Options & options)
 	:	_initial(initial_polytope),
-		_inner_product_vectors(_initial.real_dimension()),
-		_computed_next(false) {
+		_inner_product_vectors(make_vectors(_initial, options)),
+		_computed_next(false),
+		_batch_pos(boost::dynamic_bitset<>::npos),
+		_gray_code(options.gray_code),
+		_incremental(_gray_code ? PolytopeCandidate::Incremental(_initial)
+				: PolytopeCandidate::Incremental()),
+		_gray_steps(0),
+		_gray_last(),
+		_dotted(options.dotted),
+		_angles(options.angles),
+		_angle_check(),
+		_next_rank(_inner_product_vectors.rank()),
+		_resume_rank(_next_rank) {
+	has_next();
+}
+PolytopeExtender::PolytopeExtender(const PolytopeExtender & other,
+		const InnerProductVectors::Range & range)
+	:	_initial(other._initial),
+		_inner_product_vectors(other._inner_product_vectors, range),
+		_computed_next(false),
+		_batch_pos(boost::dynamic_bitset<>::npos),
+		_gray_code(other._gray_code),
+		_incremental(other._incremental),
+		_gray_steps(0),
+		_gray_last(),
+		_dotted(other._dotted),
+		_angles(other._angles),
+		_angle_check(other._angle_check),
+		_next_rank(_inner_product_vectors.rank()),
+		_resume_rank(_next_rank) {
 	has_next();
 }
 /**
@@ -37,6 +100,9 @@ bool
 PolytopeExtender::has_next(){
 	if(!_computed_next) {
 		_computed_next = compute_next();
+		if(!_computed_next) {
+			_next_rank = _inner_product_vectors.rank();
+		}
 	}
 	return _computed_next;
 }
@@ -46,22 +112,78 @@ PolytopeExtender::has_next(){
 const PolytopeCandidate &
 PolytopeExtender::next(){
 	_computed_next = false;
+	_resume_rank = _next_rank;
 	return _next;
 }
 bool
 PolytopeExtender::compute_next() {
-	bool success = false;
-	while(!success && _inner_product_vectors.has_next()) {
-		success = _initial.extend_by_inner_products(_next,
-				_inner_product_vectors.next());
-		/*
-		if(success && n[0] < -0.7 && n[0] > -0.8 && n[1] == 0 && n[2] == 0 && n[3] == 0) {
-			_next.gram().print("Found it:");
-			_next.vector_family().underlying_matrix().print("Vectors:");
+	if(_gray_code) {
+		return compute_next_gray();
+	}
+	do {
+		if(_batch_pos != boost::dynamic_bitset<>::npos) {
+			_batch_pos = _batch_valid.find_next(_batch_pos);
+		}
+		while(_batch_pos == boost::dynamic_bitset<>::npos) {
+			if(!fill_batch()) {
+				return false;
+			}
+			_batch_pos = _batch_valid.find_first();
 		}
-		*/
+		_initial.extend_by_vector(_next, _batch_vectors.unsafe_col(_batch_pos));
+	} while(_angles && !_angle_check(_next));
+	_next_rank = _batch_ranks[_batch_pos] + 1;
+	return true;
+}
+bool
+PolytopeExtender::fill_batch() {
+	if(!_inner_product_vectors.has_next()) {
+		return false;
 	}
-	return success;
+	_inner_product_vectors.next_block(_batch_products, batch_size,
+			&_batch_ranks);
+	_initial.extend_batch(_batch_products, _batch_valid, _batch_vectors);
+	if(_dotted.restricted()) {
+		for(auto i = _batch_valid.find_first(); i != boost::dynamic_bitset<>::npos;
+				i = _batch_valid.find_next(i)) {
+			if(!_dotted.contains(
+						_initial.dotted_edges(_batch_vectors.unsafe_col(i)))) {
+				_batch_valid.reset(i);
+			}
+		}
+	}
+	return true;
+}
+bool
+PolytopeExtender::compute_next_gray() {
+	while(_inner_product_vectors.has_next()) {
+		const arma::vec & inner = _inner_product_vectors.next();
+		const std::size_t changed = _inner_product_vectors.changed_index();
+		if(_gray_steps == 0) {
+			_incremental.reset(inner);
+		} else if(changed < inner.n_elem) {
+			_incremental.update(changed, _inner_product_vectors.change());
+		} else {
+			// Pruning skipped some vectors, so several entries may have changed.
+			for(arma::uword i = 0; i < inner.n_elem; ++i) {
+				if(inner[i] != _gray_last[i]) {
+					_incremental.update(i, inner[i] - _gray_last[i]);
+				}
+			}
+		}
+		_gray_last = inner;
+		if(++_gray_steps == gray_resync) {
+			_gray_steps = 0;
+		}
+		if(_incremental.compute() && (!_dotted.restricted()
+					|| _dotted.contains(_initial.dotted_edges(_incremental.vector())))) {
+			_initial.extend_by_vector(_next, _incremental.vector());
+			if(!_angles || _angle_check(_next)) {
+				_next_rank = _inner_product_vectors.rank();
+				return true;
+			}
+		}
+	}
+	return false;
 }
 }
-
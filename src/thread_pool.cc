@@ -0,0 +1,140 @@
+/*
+ * thread_pool.cc
+ * Copyright 2015 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace ptope {
+namespace {
+/* The pool and worker index of the current thread, if it is a worker. */
+thread_local const ThreadPool * current_pool = nullptr;
+thread_local std::size_t current_worker = 0;
+}
+ThreadPool::ThreadPool(std::size_t n_threads)
+	:	_pending(0),
+		_queued(0),
+		_stop(false),
+		_error(),
+		_next_queue(0) {
+	if(n_threads == 0) {
+		n_threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for(std::size_t i = 0; i < n_threads; ++i) {
+		_queues.emplace_back(new Queue());
+	}
+	for(std::size_t i = 0; i < n_threads; ++i) {
+		_threads.emplace_back(&ThreadPool::run, this, i);
+	}
+}
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_work_cv.notify_all();
+	for(std::thread & t : _threads) {
+		t.join();
+	}
+}
+void
+ThreadPool::submit(Task task) {
+	std::size_t queue;
+	if(current_pool == this) {
+		queue = current_worker;
+	} else {
+		queue = _next_queue++ % _queues.size();
+	}
+	/* Count the task before it becomes visible, so a worker can never take a
+	 * task which has not yet been counted. */
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		++_pending;
+		++_queued;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_queues[queue]->mutex);
+		_queues[queue]->tasks.push_back(std::move(task));
+	}
+	_work_cv.notify_one();
+}
+void
+ThreadPool::wait() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_done_cv.wait(lock, [this]() { return _pending == 0; });
+	if(_error) {
+		std::exception_ptr error = _error;
+		_error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+bool
+ThreadPool::pop(std::size_t worker, Task & task) {
+	{
+		Queue & own = *_queues[worker];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if(!own.tasks.empty()) {
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			return true;
+		}
+	}
+	for(std::size_t i = 1, max = _queues.size(); i < max; ++i) {
+		Queue & victim = *_queues[(worker + i) % max];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if(!victim.tasks.empty()) {
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+void
+ThreadPool::run(std::size_t worker) {
+	current_pool = this;
+	current_worker = worker;
+	Task task;
+	while(true) {
+		if(pop(worker, task)) {
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				--_queued;
+			}
+			std::exception_ptr error;
+			try {
+				task(worker);
+			} catch(...) {
+				error = std::current_exception();
+			}
+			task = nullptr;
+			std::lock_guard<std::mutex> lock(_mutex);
+			if(error && !_error) {
+				_error = error;
+			}
+			if(--_pending == 0) {
+				_done_cv.notify_all();
+			}
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(_mutex);
+		_work_cv.wait(lock, [this]() { return _stop || _queued > 0; });
+		if(_stop && _queued == 0) {
+			return;
+		}
+	}
+}
+}
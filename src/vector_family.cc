@@ -24,6 +24,12 @@ VectorFamily::VectorFamily(arma::mat && mat)
 VectorFamily::VectorFamily(const double * vector_ptr, int vector_dim,
 		int no_vectors)
 	: _vectors(vector_ptr, vector_dim, no_vectors) {}
+void
+VectorFamily::assign(const double * vector_ptr, int vector_dim,
+		int no_vectors) {
+	_vectors.set_size(vector_dim, no_vectors);
+	arma::arrayops::copy(_vectors.memptr(), vector_ptr, _vectors.n_elem);
+}
 
 void
 VectorFamily::add_vector(const arma::mat & vec) {
@@ -0,0 +1,216 @@
+/*
+ * batch_cholesky_test.cc
+ * Copyright 2016 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "batch_cholesky.h"
+
+#include "elliptic_factory.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace ptope {
+namespace {
+/* Whether the matrix is positive definite, using its eigenvalues. */
+bool
+eig_positive(const arma::mat & m) {
+	arma::vec eigs = arma::eig_sym(m);
+	return eigs(0) > 1e-10;
+}
+/* Random symmetric matrices with unit diagonal, some positive definite. */
+std::vector<arma::mat>
+random_matrices(std::size_t size, std::size_t count) {
+	std::mt19937 gen(size);
+	std::uniform_real_distribution<double> dist(-0.4, 0.4);
+	std::vector<arma::mat> result;
+	for(std::size_t c = 0; c < count; ++c) {
+		arma::mat m(size, size);
+		for(std::size_t j = 0; j < size; ++j) {
+			m(j, j) = 1;
+			for(std::size_t i = 0; i < j; ++i) {
+				m(i, j) = m(j, i) = dist(gen);
+			}
+		}
+		result.push_back(m);
+	}
+	return result;
+}
+}
+TEST(BatchCholesky, Elliptic) {
+	BatchCholesky batch;
+	batch.reset(4);
+	batch.add(elliptic_factory::type_a(4).memptr(), 4);
+	batch.add(elliptic_factory::type_f(4).memptr(), 4);
+	arma::mat affine = elliptic_factory::type_a(4);
+	affine(0, 3) = affine(3, 0) = -0.5;
+	batch.add(affine.memptr(), 4);
+	batch.run();
+	ASSERT_EQ(3u, batch.size());
+	EXPECT_TRUE(batch.positive_definite(0));
+	EXPECT_TRUE(batch.positive_definite(1));
+	EXPECT_FALSE(batch.positive_definite(2));
+}
+TEST(BatchCholesky, MatchesEigenvalues) {
+	BatchCholesky batch;
+	std::size_t n_positive = 0;
+	std::size_t n_total = 0;
+	for(std::size_t size = 3; size <= 10; ++size) {
+		const std::vector<arma::mat> matrices = random_matrices(size, 50);
+		batch.reset(size);
+		for(const arma::mat & m : matrices) {
+			batch.add(m.memptr(), size);
+		}
+		batch.run();
+		for(std::size_t i = 0; i < matrices.size(); ++i) {
+			EXPECT_EQ(eig_positive(matrices[i]), batch.positive_definite(i));
+			n_positive += batch.positive_definite(i);
+			++n_total;
+		}
+	}
+	EXPECT_LT(0u, n_positive);
+	EXPECT_GT(n_total, n_positive);
+}
+TEST(BatchCholesky, SharedBlock) {
+	/*
+	 * E8 together with a vector orthogonal to all of it, and a vector which
+	 * only meets vector 6, with inner product -1.5.
+	 */
+	const arma::mat e8 = elliptic_factory::type_e(8);
+	arma::mat m(10, 10);
+	for(std::size_t j = 0; j < 10; ++j) {
+		for(std::size_t i = 0; i < 10; ++i) {
+			m(i, j) = (i < 8 && j < 8) ? e8(i, j) : (i == j ? 1 : 0);
+		}
+	}
+	m(6, 9) = m(9, 6) = -1.5;
+	BatchCholesky batch;
+	arma::mat chol = arma::chol(m.submat(0, 0, 6, 6));
+	batch.reset(8, chol, 7);
+	std::vector<std::size_t> indices = { 0, 1, 2, 3, 4, 5, 6, 0 };
+	for(std::size_t last : { 7, 9, 8, 7, 9, 8, 7, 8, 8, 9 }) {
+		indices.back() = last;
+		batch.add(m, indices);
+	}
+	batch.run();
+	const bool expected[] = { true, false, true, true, false, true, true, true,
+		true, false };
+	for(std::size_t i = 0; i < batch.size(); ++i) {
+		EXPECT_EQ(expected[i], batch.positive_definite(i)) << "matrix " << i;
+	}
+	batch.clear();
+	EXPECT_EQ(0u, batch.size());
+}
+TEST(BatchCholesky, ScreenMatchesDouble) {
+	BatchCholesky screened;
+	BatchCholesky exact;
+	exact.set_screen_margin(0);
+	for(std::size_t size = 3; size <= 10; ++size) {
+		const std::vector<arma::mat> matrices = random_matrices(size, 40);
+		screened.reset(size);
+		exact.reset(size);
+		for(const arma::mat & m : matrices) {
+			screened.add(m.memptr(), size);
+			exact.add(m.memptr(), size);
+		}
+		screened.run();
+		exact.run();
+		EXPECT_EQ(0u, exact.screened());
+		EXPECT_LT(0u, screened.screened());
+		for(std::size_t i = 0; i < matrices.size(); ++i) {
+			EXPECT_EQ(exact.positive_definite(i), screened.positive_definite(i));
+		}
+	}
+}
+TEST(BatchCholesky, NearlySingularAmbiguous) {
+	/*
+	 * Affine A3 is positive semi-definite, so shrinking or growing its off
+	 * diagonal entries very slightly gives matrices which are only just
+	 * definite or indefinite. Only full batches are screened, so each matrix
+	 * is added four times.
+	 */
+	const arma::mat affine = { { 1, -0.5, 0, -0.5 }, { -0.5, 1, -0.5, 0 },
+		{ 0, -0.5, 1, -0.5 }, { -0.5, 0, -0.5, 1 } };
+	BatchCholesky batch;
+	batch.reset(4);
+	const double scales[] = { 1 - 1e-9, 1 + 1e-9, 0.5, 1.5 };
+	for(std::size_t c = 0; c < BatchCholesky::screen_lanes; ++c) {
+		arma::mat m = affine * scales[c % 4];
+		for(std::size_t i = 0; i < 4; ++i) {
+			m(i, i) = 1;
+		}
+		batch.add(m.memptr(), 4);
+	}
+	batch.run();
+	EXPECT_EQ(BatchCholesky::screen_lanes, batch.screened());
+	EXPECT_EQ(BatchCholesky::screen_lanes / 2, batch.ambiguous());
+	for(std::size_t c = 0; c < batch.size(); ++c) {
+		EXPECT_EQ(c % 2 == 0, batch.positive_definite(c)) << "matrix " << c;
+	}
+}
+TEST(BatchCholesky, IllConditionedShared) {
+	/*
+	 * The shared block [[1, c], [c, 1]] has a second pivot of 1 - c^2. Close
+	 * to c = -1 its factor's last entry is tiny, so the entries of each
+	 * matrix divided by it lose most of their digits in single precision, even
+	 * though the last pivot is far from zero compared to a_jj + s. The new
+	 * row and column are chosen so that the last pivot is a small multiple of
+	 * +-s, with y_2 the second entry of the solve against the shared factor.
+	 */
+	for(double gap : { 0.5, 1e-10, 1e-12 }) {
+		const double c = -(1 - gap);
+		const arma::mat shared = { { 1, c }, { c, 1 } };
+		const arma::mat chol = arma::chol(shared);
+		BatchCholesky batch;
+		for(double y_2 : { 0.5, 2.0, 10.0 }) {
+			for(double t : { 1e-3, 3e-3 }) {
+				batch.reset(3, chol, 2);
+				std::vector<arma::mat> matrices;
+				for(std::size_t l = 0; l < BatchCholesky::screen_lanes; ++l) {
+					const double b = c + chol(1, 1) * y_2 * (1 + 0.37 * l);
+					const double y = (b - c) / chol(1, 1);
+					const double s = 1 + y * y;
+					const double diag = s + (l % 2 ? t : -t) * s;
+					matrices.push_back({ { 1, c, 1 }, { c, 1, b }, { 1, b, diag } });
+					batch.add(matrices.back().memptr(), 3);
+				}
+				batch.run();
+				EXPECT_EQ(BatchCholesky::screen_lanes, batch.screened());
+				if(gap < 1e-6) {
+					/* The screen cannot trust any of these pivots. */
+					EXPECT_EQ(BatchCholesky::screen_lanes, batch.ambiguous());
+				} else {
+					EXPECT_EQ(0u, batch.ambiguous());
+				}
+				for(std::size_t l = 0; l < matrices.size(); ++l) {
+					arma::mat factor;
+					EXPECT_EQ(arma::chol(factor, matrices[l]),
+							batch.positive_definite(l)) << "gap " << gap << " matrix " << l;
+				}
+			}
+		}
+	}
+}
+TEST(BatchCholesky, SubmatrixIndices) {
+	const arma::mat m = random_matrices(10, 1).front();
+	BatchCholesky batch;
+	batch.reset(4);
+	const std::vector<std::size_t> indices = { 7, 2, 5, 0 };
+	batch.add(m, indices);
+	batch.run();
+	arma::uvec idx = { 7, 2, 5, 0 };
+	EXPECT_EQ(eig_positive(m.submat(idx, idx)), batch.positive_definite(0));
+}
+}
@@ -18,6 +18,8 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+
 namespace ptope {
 TEST(BlockDiagonalCheck, Identity2) {
 	arma::mat id(2,2);
@@ -42,5 +44,39 @@ TEST(BlockDiagonalCheck, LargeDisconnected) {
 	BlockDiagonalCheck filter;
 	EXPECT_FALSE(filter(b));
 }
+TEST(BlockDiagonalCheck, Components) {
+	arma::mat b = 
+	{ { 1, 1, 1, 0, 0, 0, 0 }, 
+		{ 1, 1, 0, 0, 0, 0, 0 },
+		{ 1, 0, 1, 0, 0, 0, 0 },
+		{ 0, 0, 0, 1, 0, 0, 0 },
+		{ 0, 0, 0, 0, 1, 1, 0 },
+		{ 0, 0, 0, 0, 1, 1, 0 },
+		{ 0, 0, 0, 0, 0, 0, 0 } };
+	BlockDiagonalCheck filter;
+	ASSERT_EQ(4u, filter.decompose(b));
+	std::vector<BlockDiagonalCheck::Component> comps;
+	for(std::size_t i = 0; i < filter.n_components(); ++i) {
+		BlockDiagonalCheck::Component c = filter.component(i);
+		std::sort(c.begin(), c.end());
+		comps.push_back(c);
+	}
+	std::sort(comps.begin(), comps.end());
+	std::vector<BlockDiagonalCheck::Component> expected = { { 0, 1, 2 }, { 3 },
+		{ 4, 5 }, { 6 } };
+	EXPECT_EQ(expected, comps);
+}
+TEST(BlockDiagonalCheck, Subset) {
+	arma::mat b = 
+	{ { 1, 1, 0, 0 }, 
+		{ 1, 1, 1, 0 },
+		{ 0, 1, 1, 1 },
+		{ 0, 0, 1, 1 } };
+	BlockDiagonalCheck filter;
+	/* Dropping vector 1 splits the path. */
+	std::vector<arma::uword> indices = { 0, 2, 3 };
+	ASSERT_EQ(2u, filter.decompose(b, indices));
+	EXPECT_EQ(1u, filter.decompose(b, std::vector<arma::uword>{ 1, 2, 3 }));
+	EXPECT_EQ(3u, filter.component(0).size());
+}
 }
-
@@ -0,0 +1,192 @@
+/*
+ * elliptic_classifier_test.cc
+ * Copyright 2016 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "elliptic_classifier.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "angles.h"
+#include "calc.h"
+#include "elliptic_factory.h"
+
+namespace ptope {
+namespace {
+typedef EllipticClassifier::Result Result;
+/* Classify the whole diagram given by the gram matrix. */
+Result
+classify_all(const arma::mat & gram) {
+	EllipticClassifier classifier;
+	classifier.set_gram(gram);
+	std::vector<std::size_t> indices(gram.n_cols);
+	for(std::size_t i = 0; i < indices.size(); ++i) {
+		indices[i] = i;
+	}
+	return classifier.classify(indices);
+}
+/* Gram matrix of the diagram with the given labels, 2 meaning no edge. */
+arma::mat
+from_labels(const std::vector<std::vector<unsigned int>> & labels) {
+	arma::mat result(labels.size(), labels.size());
+	for(std::size_t i = 0; i < labels.size(); ++i) {
+		for(std::size_t j = 0; j < labels.size(); ++j) {
+			result(i, j) = i == j ? 1 : calc::min_cos_angle(labels[i][j]);
+		}
+	}
+	return result;
+}
+/* Edge of a diagram joining vertices i and j with label m. */
+struct DiagramEdge {
+	std::size_t i;
+	std::size_t j;
+	unsigned int m;
+};
+/* Gram matrix of the diagram on size vertices with the given edges. */
+arma::mat
+from_edges(std::size_t size, const std::vector<DiagramEdge> & edges) {
+	std::vector<std::vector<unsigned int>> labels(size,
+			std::vector<unsigned int>(size, 2));
+	for(const DiagramEdge & e : edges) {
+		labels[e.i][e.j] = labels[e.j][e.i] = e.m;
+	}
+	return from_labels(labels);
+}
+}
+TEST(EllipticClassifier, EllipticTypes) {
+	Angles::get().set_angles({2, 3, 4, 5, 6, 8});
+	for(uint n = 1; n < 9; ++n) {
+		EXPECT_EQ(Result::Elliptic, classify_all(elliptic_factory::type_a(n)));
+	}
+	for(uint n = 2; n < 9; ++n) {
+		EXPECT_EQ(Result::Elliptic, classify_all(elliptic_factory::type_b(n)));
+	}
+	for(uint n = 4; n < 9; ++n) {
+		EXPECT_EQ(Result::Elliptic, classify_all(elliptic_factory::type_d(n)));
+	}
+	for(uint n = 6; n < 9; ++n) {
+		EXPECT_EQ(Result::Elliptic, classify_all(elliptic_factory::type_e(n)));
+	}
+	EXPECT_EQ(Result::Elliptic, classify_all(elliptic_factory::type_f(4)));
+	EXPECT_EQ(Result::Elliptic, classify_all(elliptic_factory::type_g(2, 6)));
+	EXPECT_EQ(Result::Elliptic, classify_all(elliptic_factory::type_h(3)));
+	EXPECT_EQ(Result::Elliptic, classify_all(elliptic_factory::type_h(4)));
+}
+TEST(EllipticClassifier, AffineTypes) {
+	Angles::get().set_angles({2, 3, 4, 5, 6, 8});
+	/* Affine A_n is a cycle. */
+	EXPECT_EQ(Result::Parabolic, classify_all(from_edges(3,
+					{ { 0, 1, 3 }, { 1, 2, 3 }, { 2, 0, 3 } })));
+	EXPECT_EQ(Result::Parabolic, classify_all(from_edges(4,
+					{ { 0, 1, 3 }, { 1, 2, 3 }, { 2, 3, 3 }, { 3, 0, 3 } })));
+	/* Affine B_n has a fork at one end and a 4 at the other. */
+	EXPECT_EQ(Result::Parabolic, classify_all(from_edges(4,
+					{ { 0, 1, 3 }, { 0, 2, 3 }, { 0, 3, 4 } })));
+	EXPECT_EQ(Result::Parabolic, classify_all(from_edges(5,
+					{ { 0, 1, 3 }, { 0, 2, 3 }, { 0, 3, 3 }, { 3, 4, 4 } })));
+	/* Affine C_n has a 4 at both ends. */
+	EXPECT_EQ(Result::Parabolic, classify_all(from_edges(3,
+					{ { 0, 1, 4 }, { 1, 2, 4 } })));
+	EXPECT_EQ(Result::Parabolic, classify_all(from_edges(5,
+					{ { 0, 1, 4 }, { 1, 2, 3 }, { 2, 3, 3 }, { 3, 4, 4 } })));
+	/* Affine D_n has a fork at both ends. */
+	EXPECT_EQ(Result::Parabolic, classify_all(from_edges(5,
+					{ { 0, 1, 3 }, { 0, 2, 3 }, { 0, 3, 3 }, { 0, 4, 3 } })));
+	EXPECT_EQ(Result::Parabolic, classify_all(from_edges(6, { { 0, 1, 3 },
+					{ 0, 2, 3 }, { 0, 3, 3 }, { 3, 4, 3 }, { 3, 5, 3 } })));
+	EXPECT_EQ(Result::Parabolic, classify_all(from_edges(7, { { 0, 1, 3 },
+					{ 0, 2, 3 }, { 0, 3, 3 }, { 3, 4, 3 }, { 4, 5, 3 }, { 4, 6, 3 } })));
+	/* Affine E_6, E_7 and E_8. */
+	EXPECT_EQ(Result::Parabolic, classify_all(from_edges(7, { { 0, 1, 3 },
+					{ 1, 2, 3 }, { 0, 3, 3 }, { 3, 4, 3 }, { 0, 5, 3 }, { 5, 6, 3 } })));
+	EXPECT_EQ(Result::Parabolic, classify_all(from_edges(8, { { 0, 1, 3 },
+					{ 0, 2, 3 }, { 2, 3, 3 }, { 3, 4, 3 }, { 0, 5, 3 }, { 5, 6, 3 },
+					{ 6, 7, 3 } })));
+	EXPECT_EQ(Result::Parabolic, classify_all(from_edges(9, { { 0, 1, 3 },
+					{ 0, 2, 3 }, { 2, 3, 3 }, { 0, 4, 3 }, { 4, 5, 3 }, { 5, 6, 3 },
+					{ 6, 7, 3 }, { 7, 8, 3 } })));
+	/* Affine F_4 and G_2. */
+	EXPECT_EQ(Result::Parabolic, classify_all(from_edges(5,
+					{ { 0, 1, 3 }, { 1, 2, 3 }, { 2, 3, 4 }, { 3, 4, 3 } })));
+	EXPECT_EQ(Result::Parabolic, classify_all(from_edges(3,
+					{ { 0, 1, 6 }, { 1, 2, 3 } })));
+	/* An affine component alongside an elliptic one. */
+	EXPECT_EQ(Result::Parabolic, classify_all(from_edges(5,
+					{ { 0, 1, 4 }, { 1, 2, 4 }, { 3, 4, 5 } })));
+}
+TEST(EllipticClassifier, NotElliptic) {
+	Angles::get().set_angles({2, 3, 4, 5, 6, 8});
+	/* A 5 in the middle of a path. */
+	EXPECT_EQ(Result::NotElliptic, classify_all(from_edges(4,
+					{ { 0, 1, 3 }, { 1, 2, 5 }, { 2, 3, 3 } })));
+	/* Two 4s which are not both at the ends of a path. */
+	EXPECT_EQ(Result::NotElliptic, classify_all(from_edges(4,
+					{ { 0, 1, 4 }, { 1, 2, 4 }, { 2, 3, 3 } })));
+	/* Affine E_8 with its longest arm extended. */
+	EXPECT_EQ(Result::NotElliptic, classify_all(from_edges(10, { { 0, 1, 3 },
+					{ 0, 2, 3 }, { 2, 3, 3 }, { 0, 4, 3 }, { 4, 5, 3 }, { 5, 6, 3 },
+					{ 6, 7, 3 }, { 7, 8, 3 }, { 8, 9, 3 } })));
+	/* A cycle with a label other than 3. */
+	EXPECT_EQ(Result::NotElliptic, classify_all(from_edges(3,
+					{ { 0, 1, 3 }, { 1, 2, 3 }, { 2, 0, 4 } })));
+	/* Affine G_2 and affine C_2 joined into a single path. */
+	EXPECT_EQ(Result::NotElliptic, classify_all(from_edges(5,
+					{ { 0, 1, 6 }, { 1, 2, 3 }, { 2, 3, 4 }, { 3, 4, 4 } })));
+	/* A dotted edge cannot be classified. */
+	arma::mat dotted = elliptic_factory::type_a(3);
+	dotted(0, 2) = dotted(2, 0) = -1.5;
+	EXPECT_EQ(Result::Unknown, classify_all(dotted));
+}
+TEST(EllipticClassifier, MatchesEigenvalues) {
+	Angles::get().set_angles({2, 3, 4, 5, 6, 8});
+	const std::vector<unsigned int> choices = { 2, 2, 2, 2, 3, 3, 4, 5, 6, 8 };
+	std::mt19937 gen(7);
+	std::uniform_int_distribution<std::size_t> dist(0, choices.size() - 1);
+	const std::size_t size = 8;
+	for(int trial = 0; trial < 40; ++trial) {
+		std::vector<std::vector<unsigned int>> labels(size,
+				std::vector<unsigned int>(size, 2));
+		for(std::size_t i = 0; i < size; ++i) {
+			for(std::size_t j = 0; j < i; ++j) {
+				labels[i][j] = labels[j][i] = choices[dist(gen)];
+			}
+		}
+		const arma::mat gram = from_labels(labels);
+		EllipticClassifier classifier;
+		classifier.set_gram(gram);
+		for(std::size_t subset = 1; subset < (1u << size); ++subset) {
+			std::vector<std::size_t> indices;
+			for(std::size_t i = 0; i < size; ++i) {
+				if(subset & (1u << i)) {
+					indices.push_back(i);
+				}
+			}
+			arma::mat sub(indices.size(), indices.size());
+			for(std::size_t a = 0; a < indices.size(); ++a) {
+				for(std::size_t b = 0; b < indices.size(); ++b) {
+					sub(a, b) = gram(indices[a], indices[b]);
+				}
+			}
+			arma::vec eigvals;
+			arma::eig_sym(eigvals, sub);
+			/* Parabolic diagrams have a zero eigenvalue, so leave a margin. */
+			const Result expected = eigvals(0) > 1e-10 ? Result::Elliptic
+				: eigvals(0) > -1e-10 ? Result::Parabolic : Result::NotElliptic;
+			EXPECT_EQ(expected, classifier.classify(indices));
+		}
+	}
+}
+}
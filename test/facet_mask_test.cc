@@ -0,0 +1,87 @@
+/*
+ * facet_mask_test.cc
+ * Copyright 2016 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "facet_mask.h"
+#include "gtest/gtest.h"
+
+namespace ptope {
+TEST(FacetMask, SetAndIterate) {
+	FacetMask<2> mask;
+	EXPECT_EQ(0u, mask.count());
+	mask.set(3);
+	mask.set(63);
+	mask.set(64);
+	mask.set(100);
+	EXPECT_EQ(4u, mask.count());
+	EXPECT_TRUE(mask.test(63));
+	EXPECT_TRUE(mask.test(64));
+	EXPECT_FALSE(mask.test(65));
+
+	std::vector<std::size_t> facets;
+	mask.for_each([&facets](std::size_t f) { facets.push_back(f); });
+	EXPECT_EQ(std::vector<std::size_t>({ 3, 63, 64, 100 }), facets);
+
+	FacetMask<2> edge = mask.without(64);
+	EXPECT_EQ(3u, edge.count());
+	EXPECT_NE(mask, edge);
+	EXPECT_EQ(mask, edge.with(64));
+	EXPECT_EQ(mask.hash(), edge.with(64).hash());
+}
+TEST(FacetMaskSet, AddSame) {
+	FacetMaskSet<1> set;
+	FacetMask<1> a;
+	a.set(1);
+	a.set(5);
+	EXPECT_FALSE(set.contains(a));
+	EXPECT_TRUE(set.add(a));
+	EXPECT_TRUE(set.contains(a));
+	EXPECT_FALSE(set.add(a));
+	EXPECT_EQ(1u, set.size());
+	set.clear();
+	EXPECT_FALSE(set.contains(a));
+	EXPECT_EQ(0u, set.size());
+}
+TEST(FacetMaskSet, Grow) {
+	FacetMaskSet<2> set;
+	/* Every pair of facets, which forces the table to be resized. */
+	std::size_t count = 0;
+	for(std::size_t i = 0; i < 80; ++i) {
+		for(std::size_t j = i + 1; j < 80; ++j) {
+			FacetMask<2> mask;
+			mask.set(i);
+			mask.set(j);
+			ASSERT_TRUE(set.add(mask));
+			++count;
+		}
+	}
+	EXPECT_EQ(count, set.size());
+	for(std::size_t i = 0; i < 80; ++i) {
+		for(std::size_t j = i + 1; j < 80; ++j) {
+			FacetMask<2> mask;
+			mask.set(i);
+			mask.set(j);
+			EXPECT_TRUE(set.contains(mask));
+			EXPECT_FALSE(set.add(mask));
+			mask.set(90);
+			EXPECT_FALSE(set.contains(mask));
+		}
+	}
+	FacetMask<2> first;
+	first.set(0);
+	first.set(1);
+	EXPECT_EQ(first, set.at(0));
+}
+}
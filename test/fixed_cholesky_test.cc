@@ -0,0 +1,316 @@
+/*
+ * fixed_cholesky_test.cc
+ * Copyright 2016 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "fixed_cholesky.h"
+
+#include "calc.h"
+#include "elliptic_factory.h"
+
+#include <armadillo>
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace ptope {
+namespace {
+/** Padding rows below each block, so that the leading dimension is tested. */
+constexpr std::size_t padding = 3;
+/** Value stored in the padding, which the kernels must never read. */
+constexpr double poison = 1e300;
+/**
+ * The matrix L D L^T, where L is unit lower triangular with small integer
+ * entries and D is diagonal. All its entries are integers, and so are those
+ * of its cholesky factor while the pivots are 1, so every step of the
+ * decomposition is exact whatever order potrf adds the terms in. The pivots of
+ * the decomposition are then exactly the entries of D.
+ */
+arma::mat
+ldlt(std::size_t size, const arma::vec & d) {
+	arma::mat l(size, size);
+	l.zeros();
+	for(std::size_t i = 0; i < size; ++i) {
+		l(i, i) = 1;
+		for(std::size_t k = 0; k < i; ++k) {
+			l(i, k) = static_cast<double>((i + 2 * k) % 3) - 1;
+		}
+	}
+	arma::mat ld(l);
+	for(std::size_t k = 0; k < size; ++k) {
+		for(std::size_t i = 0; i < size; ++i) {
+			ld(i, k) *= d(k);
+		}
+	}
+	return ld * l.t();
+}
+/** Pivots which are all 1, except for the one at index, which is value. */
+arma::vec
+pivots(std::size_t size, std::size_t index, double value) {
+	arma::vec d(size);
+	for(std::size_t i = 0; i < size; ++i) {
+		d(i) = 1;
+	}
+	if(index < size) {
+		d(index) = value;
+	}
+	return d;
+}
+/** Copy of m with padding rows holding poison. */
+arma::mat
+padded(const arma::mat & m) {
+	arma::mat result(m.n_rows + padding, m.n_cols);
+	for(arma::uword j = 0; j < m.n_cols; ++j) {
+		for(arma::uword i = 0; i < result.n_rows; ++i) {
+			result(i, j) = i < m.n_rows ? m(i, j) : poison;
+		}
+	}
+	return result;
+}
+/** Random symmetric matrices with unit diagonal, some positive definite. */
+std::vector<arma::mat>
+random_matrices(std::size_t size, std::size_t count) {
+	std::mt19937 gen(size);
+	std::uniform_real_distribution<double> dist(-0.6, 0.6);
+	std::vector<arma::mat> result;
+	for(std::size_t c = 0; c < count; ++c) {
+		arma::mat m(size, size);
+		for(std::size_t j = 0; j < size; ++j) {
+			m(j, j) = 1;
+			for(std::size_t i = 0; i < j; ++i) {
+				m(i, j) = m(j, i) = dist(gen);
+			}
+		}
+		result.push_back(m);
+	}
+	return result;
+}
+/**
+ * Whether adding the column col with diagonal entry diag to the elliptic
+ * matrix edge gives a positive definite matrix, first factoring edge as
+ * PolytopeCheck does and then calling schur_positive.
+ */
+bool
+edge_schur_positive(const arma::mat & edge, const arma::vec & col,
+		double diag) {
+	const std::size_t size = edge.n_rows;
+	arma::mat chol(edge);
+	if(size <= fixed_cholesky::max_size) {
+		EXPECT_TRUE(fixed_cholesky::chol_in_place(chol.memptr(), size, size));
+	} else {
+		chol = arma::chol(edge);
+	}
+	arma::vec tmp(col);
+	return fixed_cholesky::schur_positive(chol.memptr(), size, size,
+			tmp.memptr(), diag);
+}
+/** The matrix edge with col and diag added as a last row and column. */
+arma::mat
+vertex_matrix(const arma::mat & edge, const arma::vec & col, double diag) {
+	const arma::uword size = edge.n_rows;
+	arma::mat result(size + 1, size + 1);
+	for(arma::uword j = 0; j < size; ++j) {
+		for(arma::uword i = 0; i < size; ++i) {
+			result(i, j) = edge(i, j);
+		}
+		result(size, j) = result(j, size) = col(j);
+	}
+	result(size, size) = diag;
+	return result;
+}
+/**
+ * Check chol_in_place<Size> gives the same verdict as potrf on m, and where m
+ * is positive definite the same factor, within tol of each entry.
+ */
+template <std::size_t Size>
+void
+check_chol(const arma::mat & m, double tol) {
+	arma::mat expected;
+	bool const expected_pd = arma::chol(expected, m);
+	arma::mat block = padded(m);
+	bool const pd = fixed_cholesky::chol_in_place<Size>(block.memptr(),
+			block.n_rows);
+	EXPECT_EQ(expected_pd, pd) << "size " << Size;
+	arma::mat by_table = padded(m);
+	EXPECT_EQ(pd, fixed_cholesky::chol_in_place(by_table.memptr(), Size,
+				by_table.n_rows)) << "size " << Size;
+	for(arma::uword i = Size; i < block.n_rows; ++i) {
+		EXPECT_EQ(poison, block(i, 0));
+	}
+	if(!pd || !expected_pd) {
+		return;
+	}
+	for(arma::uword j = 0; j < Size; ++j) {
+		for(arma::uword i = 0; i <= j; ++i) {
+			EXPECT_NEAR(expected(i, j), block(i, j), tol)
+				<< "size " << Size << " at (" << i << ", " << j << ")";
+			EXPECT_EQ(block(i, j), by_table(i, j));
+		}
+	}
+}
+/**
+ * Check schur_positive<Size> on the leading block of the (Size + 1) x
+ * (Size + 1) matrix m, factored by potrf, gives the same verdict as potrf on
+ * all of m, and where m is positive definite the same last column of the
+ * factor.
+ */
+template <std::size_t Size>
+void
+check_schur(const arma::mat & m, double tol) {
+	arma::mat expected;
+	bool const expected_pd = arma::chol(expected, m);
+	arma::mat chol;
+	ASSERT_TRUE(arma::chol(chol, m.submat(0, 0, Size - 1, Size - 1)));
+	chol = padded(chol);
+	arma::vec col(Size);
+	arma::vec col_by_table(Size);
+	for(arma::uword i = 0; i < Size; ++i) {
+		col(i) = col_by_table(i) = m(i, Size);
+	}
+	bool const pd = fixed_cholesky::schur_positive<Size>(chol.memptr(),
+			chol.n_rows, col.memptr(), m(Size, Size));
+	EXPECT_EQ(expected_pd, pd) << "size " << Size;
+	EXPECT_EQ(pd, fixed_cholesky::schur_positive(chol.memptr(), Size,
+				chol.n_rows, col_by_table.memptr(), m(Size, Size)));
+	if(!pd || !expected_pd) {
+		return;
+	}
+	for(arma::uword i = 0; i < Size; ++i) {
+		EXPECT_NEAR(expected(i, Size), col(i), tol)
+			<< "size " << Size << " at " << i;
+		EXPECT_EQ(col(i), col_by_table(i));
+	}
+}
+template <std::size_t Size>
+void
+check_size() {
+	/* Exact matrices, which the kernels and potrf must factor identically. */
+	check_chol<Size>(ldlt(Size, pivots(Size, Size, 1)), 0);
+	for(std::size_t k = 0; k < Size; ++k) {
+		check_chol<Size>(ldlt(Size, pivots(Size, k, 0)), 0);
+		check_chol<Size>(ldlt(Size, pivots(Size, k, -1)), 0);
+	}
+	check_schur<Size>(ldlt(Size + 1, pivots(Size + 1, Size + 1, 1)), 0);
+	check_schur<Size>(ldlt(Size + 1, pivots(Size + 1, Size, 0)), 0);
+	check_schur<Size>(ldlt(Size + 1, pivots(Size + 1, Size, -1)), 0);
+	/* Inexact matrices, which are rarely close enough to singular for the order
+	 * of rounding to matter. */
+	for(const arma::mat & m : random_matrices(Size + 1, 200)) {
+		arma::mat lead = m.submat(0, 0, Size - 1, Size - 1);
+		arma::vec eigs = arma::eig_sym(lead);
+		if(std::abs(eigs(0)) < 1e-10) {
+			continue;
+		}
+		check_chol<Size>(lead, 1e-12);
+		if(eigs(0) < 0 || std::abs(arma::eig_sym(m)(0)) < 1e-10) {
+			continue;
+		}
+		check_schur<Size>(m, 1e-12);
+	}
+}
+template <std::size_t Size>
+struct CheckSizes {
+	static void run() {
+		CheckSizes<Size - 1>::run();
+		SCOPED_TRACE(Size);
+		check_size<Size>();
+	}
+};
+template <>
+struct CheckSizes<0> {
+	static void run() {}
+};
+}
+TEST(FixedCholesky, MatchesPotrf) {
+	CheckSizes<fixed_cholesky::max_size>::run();
+}
+TEST(FixedCholesky, PositiveDefinite) {
+	/* The factor of L L^T is L^T when L is unit lower triangular. */
+	arma::mat m = padded(ldlt(9, pivots(9, 9, 1)));
+	ASSERT_TRUE(fixed_cholesky::chol_in_place<9>(m.memptr(), m.n_rows));
+	for(arma::uword j = 0; j < 9; ++j) {
+		EXPECT_EQ(1, m(j, j));
+		for(arma::uword i = 0; i < j; ++i) {
+			EXPECT_EQ(static_cast<double>((j + 2 * i) % 3) - 1, m(i, j));
+		}
+	}
+}
+TEST(FixedCholesky, Singular) {
+	for(std::size_t k = 0; k < 9; ++k) {
+		arma::mat m = padded(ldlt(9, pivots(9, k, 0)));
+		EXPECT_FALSE(fixed_cholesky::chol_in_place<9>(m.memptr(), m.n_rows));
+	}
+	arma::mat zero(1, 1);
+	zero(0, 0) = 0;
+	EXPECT_FALSE(fixed_cholesky::chol_in_place<1>(zero.memptr(), 1));
+}
+TEST(FixedCholesky, Indefinite) {
+	for(std::size_t k = 0; k < 9; ++k) {
+		arma::mat m = padded(ldlt(9, pivots(9, k, -1)));
+		EXPECT_FALSE(fixed_cholesky::chol_in_place<9>(m.memptr(), m.n_rows));
+	}
+}
+TEST(FixedCholesky, NearSingularMatchesChol) {
+	/*
+	 * An elliptic edge with a facet added which makes an affine diagram, so
+	 * that the vertex matrix is singular, then with the facet's diagonal entry
+	 * moved slightly either side. These are the closest calls a polytope check
+	 * makes, and the verdict must be the same as potrf's on the whole matrix.
+	 */
+	for(arma::uword size = 2; size <= fixed_cholesky::max_size + 3; ++size) {
+		arma::vec cycle(size);
+		arma::vec end(size);
+		for(arma::uword i = 0; i < size; ++i) {
+			cycle(i) = end(i) = 0;
+		}
+		/* A_size closed into the cycle ~A_size. */
+		cycle(0) = cycle(size - 1) = -.5;
+		/* B_size with a second label 4 at the other end, giving ~C_size. */
+		end(size - 1) = calc::min_cos_angle(4);
+		const arma::mat a = elliptic_factory::type_a(size);
+		const arma::mat b = elliptic_factory::type_b(size);
+		for(double shift : { 1e-6, 1e-9, 1e-12 }) {
+			for(double sign : { 1.0, -1.0 }) {
+				const double diag = 1 + sign * shift;
+				SCOPED_TRACE(size);
+				SCOPED_TRACE(diag);
+				arma::mat factor;
+				const bool a_pd = edge_schur_positive(a, cycle, diag);
+				EXPECT_EQ(arma::chol(factor, vertex_matrix(a, cycle, diag)), a_pd);
+				EXPECT_EQ(sign > 0, a_pd);
+				const bool b_pd = edge_schur_positive(b, end, diag);
+				EXPECT_EQ(arma::chol(factor, vertex_matrix(b, end, diag)), b_pd);
+				EXPECT_EQ(sign > 0, b_pd);
+			}
+		}
+	}
+}
+TEST(FixedCholesky, LargeSchurMatchesPotrf) {
+	/* Factors larger than max_size use the generic loop. */
+	const std::size_t size = fixed_cholesky::max_size + 3;
+	for(double pivot : { 1.0, 0.0, -1.0 }) {
+		arma::mat m = ldlt(size + 1, pivots(size + 1, size, pivot));
+		arma::mat expected;
+		bool const expected_pd = arma::chol(expected, m);
+		arma::mat chol = arma::chol(m.submat(0, 0, size - 1, size - 1));
+		arma::vec col(size);
+		for(arma::uword i = 0; i < size; ++i) {
+			col(i) = m(i, size);
+		}
+		EXPECT_EQ(expected_pd, fixed_cholesky::schur_positive(chol.memptr(), size,
+					size, col.memptr(), m(size, size)));
+	}
+}
+}
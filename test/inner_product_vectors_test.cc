@@ -0,0 +1,265 @@
+/*
+ * inner_product_vectors_test.cc
+ * Copyright 2015 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "inner_product_vectors.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <set>
+
+#include "angles.h"
+#include "calc.h"
+#include "elliptic_factory.h"
+#include "comparator.h"
+
+namespace ptope {
+TEST(InnerProductVectors, LexicographicCount) {
+	Angles::get().set_angles({2, 3, 4});
+	InnerProductVectors ipv(3);
+	std::size_t count = 0;
+	while(ipv.has_next()) {
+		ipv.next();
+		++count;
+	}
+	EXPECT_EQ(27u, count);
+}
+TEST(InnerProductVectors, GrayCode) {
+	Angles::get().set_angles({2, 3, 4, 5});
+	InnerProductVectors lex(3);
+	std::set<arma::vec, comparator::VecLess> all;
+	while(lex.has_next()) {
+		all.insert(lex.next());
+	}
+
+	InnerProductVectors gray(3, InnerProductVectors::Order::Gray);
+	std::set<arma::vec, comparator::VecLess> seen;
+	arma::vec last;
+	while(gray.has_next()) {
+		const arma::vec & v = gray.next();
+		if(seen.empty()) {
+			EXPECT_EQ(3u, gray.changed_index());
+		} else {
+			std::size_t n_diff = 0;
+			for(arma::uword i = 0; i < v.size(); ++i) {
+				if(v(i) != last(i)) {
+					++n_diff;
+					EXPECT_EQ(i, gray.changed_index());
+					EXPECT_DOUBLE_EQ(v(i) - last(i), gray.change());
+				}
+			}
+			EXPECT_EQ(1u, n_diff);
+		}
+		EXPECT_TRUE(seen.insert(v).second);
+		last = v;
+	}
+	EXPECT_EQ(all.size(), seen.size());
+	for(const arma::vec & v : seen) {
+		EXPECT_EQ(1u, all.count(v));
+	}
+}
+TEST(InnerProductVectors, SeekRank) {
+	Angles::get().set_angles({2, 3, 4});
+	for(auto order : { InnerProductVectors::Order::Lexicographic,
+			InnerProductVectors::Order::Gray }) {
+		InnerProductVectors ipv(3, order);
+		EXPECT_EQ(27u, ipv.total());
+		std::vector<arma::vec> all;
+		while(ipv.has_next()) {
+			EXPECT_EQ(all.size(), ipv.rank());
+			all.push_back(ipv.next());
+		}
+		EXPECT_EQ(27u, ipv.rank());
+		for(std::size_t rank : { 0u, 1u, 5u, 13u, 26u }) {
+			ipv.seek(rank);
+			ASSERT_TRUE(ipv.has_next());
+			EXPECT_EQ(rank, ipv.rank());
+			const arma::vec & v = ipv.next();
+			for(arma::uword i = 0; i < v.size(); ++i) {
+				EXPECT_EQ(all[rank](i), v(i));
+			}
+		}
+		ipv.seek(27);
+		EXPECT_FALSE(ipv.has_next());
+	}
+}
+TEST(InnerProductVectors, Chunks) {
+	Angles::get().set_angles({2, 3, 4, 5});
+	InnerProductVectors full(3);
+	std::vector<arma::vec> all;
+	while(full.has_next()) {
+		all.push_back(full.next());
+	}
+	std::size_t count = 0;
+	for(std::size_t c = 0; c < 5; ++c) {
+		InnerProductVectors chunk(3, full.chunk(c, 5));
+		while(chunk.has_next()) {
+			ASSERT_LT(count, all.size());
+			const arma::vec & v = chunk.next();
+			for(arma::uword i = 0; i < v.size(); ++i) {
+				EXPECT_EQ(all[count](i), v(i));
+			}
+			++count;
+		}
+	}
+	EXPECT_EQ(all.size(), count);
+}
+TEST(InnerProductSymmetry, Order) {
+	EXPECT_EQ(2u, InnerProductSymmetry(elliptic_factory::type_a(3)).order());
+	EXPECT_EQ(6u, InnerProductSymmetry(elliptic_factory::type_d(4)).order());
+	EXPECT_EQ(1u, InnerProductSymmetry(elliptic_factory::type_b(4)).order());
+	arma::mat a2a2(4, 4);
+	a2a2.zeros();
+	a2a2.submat(0, 0, 1, 1) = elliptic_factory::type_a(2);
+	a2a2.submat(2, 2, 3, 3) = elliptic_factory::type_a(2);
+	EXPECT_EQ(8u, InnerProductSymmetry(a2a2).order());
+}
+TEST(InnerProductVectors, Symmetry) {
+	Angles::get().set_angles({2, 3, 4, 5});
+	PolytopeCandidate p(elliptic_factory::type_d(4));
+	InnerProductVectors full(4);
+	InnerProductVectors reduced(p, InnerProductVectors::Range(), false, true);
+	std::set<arma::vec, comparator::VecLess> reps;
+	std::size_t last_rank = 0;
+	while(reduced.has_next()) {
+		EXPECT_LE(last_rank, reduced.rank());
+		last_rank = reduced.rank();
+		reps.insert(reduced.next());
+	}
+	EXPECT_LT(0u, reduced.pruned_subtrees());
+	/* Type D4 has the three outer vertices 0, 1 and 3 around the centre 2, and
+	 * every orbit must be represented. */
+	const std::size_t perms[6][4] = { { 0, 1, 2, 3 }, { 0, 3, 2, 1 },
+		{ 1, 0, 2, 3 }, { 1, 3, 2, 0 }, { 3, 0, 2, 1 }, { 3, 1, 2, 0 } };
+	std::size_t n_full = 0;
+	while(full.has_next()) {
+		const arma::vec & v = full.next();
+		++n_full;
+		std::size_t found = 0;
+		for(const auto & perm : perms) {
+			arma::vec image(4);
+			for(arma::uword i = 0; i < 4; ++i) {
+				image(i) = v(perm[i]);
+			}
+			found += reps.count(image);
+		}
+		EXPECT_LE(1u, found);
+	}
+	EXPECT_LT(reps.size(), n_full);
+}
+TEST(InnerProductVectors, GrayPruned) {
+	using ptope::calc::min_cos_angle;
+	Angles::get().set_angles({2, 3, 4, 5, 8});
+	PolytopeCandidate b(elliptic_factory::type_b(4));
+	PolytopeCandidate d(elliptic_factory::type_d(4));
+	auto q = b.extend_by_inner_products({ 0, 0, 0, min_cos_angle(8) });
+	ASSERT_TRUE(q.valid());
+	for(const PolytopeCandidate & p : { b, d, q }) {
+		const InnerProductVectors::Domains domains =
+			InnerProductVectors::default_domains(p.real_dimension());
+		for(bool symmetry : { false, true }) {
+			InnerProductVectors lex(p, domains, InnerProductVectors::Range(), true,
+					symmetry);
+			InnerProductVectors gray(p, domains, InnerProductVectors::Range(), true,
+					symmetry, InnerProductBounds::DottedRange(), false,
+					InnerProductVectors::Order::Gray);
+			std::set<arma::vec, comparator::VecLess> expected;
+			while(lex.has_next()) {
+				expected.insert(lex.next());
+			}
+			std::set<arma::vec, comparator::VecLess> seen;
+			arma::vec last;
+			while(gray.has_next()) {
+				const std::size_t rank = gray.rank();
+				const arma::vec & v = gray.next();
+				/* A single change is only reported if it is the only one. */
+				if(!seen.empty() && gray.changed_index() < v.n_elem) {
+					for(arma::uword i = 0; i < v.n_elem; ++i) {
+						if(i == gray.changed_index()) {
+							EXPECT_DOUBLE_EQ(v(i) - last(i), gray.change());
+						} else {
+							EXPECT_EQ(last(i), v(i));
+						}
+					}
+				}
+				/* The ranks are still those of the full Gray code. */
+				InnerProductVectors full(domains, InnerProductVectors::Range(rank,
+							rank + 1), InnerProductVectors::Order::Gray);
+				const arma::vec & at_rank = full.next();
+				for(arma::uword i = 0; i < v.n_elem; ++i) {
+					EXPECT_EQ(at_rank(i), v(i));
+				}
+				EXPECT_TRUE(seen.insert(v).second);
+				last = v;
+			}
+			EXPECT_LT(0u, gray.pruned_subtrees());
+			EXPECT_EQ(expected.size(), seen.size());
+			for(const arma::vec & v : seen) {
+				EXPECT_EQ(1u, expected.count(v));
+			}
+		}
+	}
+}
+TEST(InnerProductVectors, Domains) {
+	using ptope::calc::min_cos_angle;
+	InnerProductVectors::Domains domains = { { 0, -.5 }, { 0 },
+		{ 0, -.5, min_cos_angle(4) } };
+	for(auto order : { InnerProductVectors::Order::Lexicographic,
+			InnerProductVectors::Order::Gray }) {
+		InnerProductVectors ipv(domains, InnerProductVectors::Range(), order);
+		EXPECT_EQ(6u, ipv.total());
+		std::set<arma::vec, comparator::VecLess> seen;
+		while(ipv.has_next()) {
+			const arma::vec & v = ipv.next();
+			for(arma::uword i = 0; i < v.size(); ++i) {
+				EXPECT_EQ(1, std::count(domains[i].begin(), domains[i].end(), v(i)));
+			}
+			EXPECT_TRUE(seen.insert(v).second);
+		}
+		EXPECT_EQ(6u, seen.size());
+		ipv.seek(4);
+		ASSERT_TRUE(ipv.has_next());
+		EXPECT_EQ(4u, ipv.rank());
+	}
+	domains[1].clear();
+	InnerProductVectors empty(domains);
+	EXPECT_EQ(0u, empty.total());
+	EXPECT_FALSE(empty.has_next());
+}
+TEST(InnerProductVectors, MaskDomains) {
+	using ptope::calc::min_cos_angle;
+	const std::uint64_t mask = (1u << 2) | (1u << 3) | (1u << 5);
+	InnerProductVectors::Domains domains =
+		InnerProductVectors::mask_domains({ mask, 1u << 4 });
+	ASSERT_EQ(2u, domains.size());
+	ASSERT_EQ(3u, domains[0].size());
+	EXPECT_DOUBLE_EQ(0, domains[0][0]);
+	EXPECT_DOUBLE_EQ(-.5, domains[0][1]);
+	EXPECT_DOUBLE_EQ(min_cos_angle(5), domains[0][2]);
+	ASSERT_EQ(1u, domains[1].size());
+	EXPECT_DOUBLE_EQ(min_cos_angle(4), domains[1][0]);
+	EXPECT_EQ(domains, InnerProductVectors::label_domains({ { 5, 2, 3 }, { 4 } }));
+}
+TEST(InnerProductSymmetry, Domains) {
+	PolytopeCandidate d4(elliptic_factory::type_d(4));
+	InnerProductVectors::Domains domains = { { 0, -.5 }, { 0, -.5 },
+		{ 0, -.5 }, { 0, -.5 } };
+	EXPECT_EQ(6u, InnerProductSymmetry(d4, domains).order());
+	/* Only vertices 1 and 3 can still be swapped. */
+	domains[0] = { 0 };
+	EXPECT_EQ(2u, InnerProductSymmetry(d4, domains).order());
+}
+}
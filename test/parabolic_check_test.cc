@@ -53,5 +53,33 @@ TEST(ParabolicCheck, 4Plus3) {
 	ASSERT_TRUE(t.valid());
 	EXPECT_FALSE(chk(t));
 }
+TEST(ParabolicCheck, Unlabelled) {
+	ParabolicCheck chk;
+	/* Affine A_1 has label infinity, so is checked numerically. */
+	arma::mat a1 = { { 1, -1 }, { -1, 1 } };
+	EXPECT_TRUE(chk(a1, 2));
+	/* A zero pivot from the first two rows, then a semi-definite extension. */
+	arma::mat psd = { { 1, -1, 0 }, { -1, 1, 0 }, { 0, 0, 1 } };
+	EXPECT_TRUE(chk(psd, 3));
+	/* The same zero pivot, but an indefinite extension. */
+	arma::mat indef = { { 1, -1, -.3 }, { -1, 1, 0 }, { -.3, 0, 1 } };
+	EXPECT_FALSE(chk(indef, 3));
+	/* A dotted edge is never semi-definite. */
+	arma::mat dotted = { { 1, -1.5 }, { -1.5, 1 } };
+	EXPECT_FALSE(chk(dotted, 2));
+}
+TEST(ParabolicCheck, SplitComponents) {
+	ParabolicCheck chk;
+	/* Affine C_2 with the last vector orthogonal to all of it. */
+	arma::mat m = { { 1, min_cos_angle(4), 0, 0 },
+			{ min_cos_angle(4), 1, min_cos_angle(4), 0 },
+			{ 0, min_cos_angle(4), 1, 0 }, { 0, 0, 0, 1 } };
+	EXPECT_TRUE(chk(m, 4));
+	EXPECT_FALSE(chk(m, 3));
+	/* Joining the last vector to the end of affine C_2 is hyperbolic, but
+	 * dropping the far end leaves B_3, which is elliptic. */
+	m(2, 3) = m(3, 2) = -.5;
+	EXPECT_FALSE(chk(m, 4));
+	EXPECT_FALSE(chk(m, 3));
+}
 }
-
@@ -0,0 +1,164 @@
+/*
+ * parallel_extender_test.cc
+ * Copyright 2015 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "parallel_extender.h"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include "angles.h"
+#include "calc.h"
+#include "elliptic_factory.h"
+
+namespace ptope {
+namespace {
+PolytopeCandidate
+hyperbolic_b4() {
+	PolytopeCandidate b(elliptic_factory::type_b(4));
+	return b.extend_by_inner_products({ 0, 0, 0, calc::min_cos_angle(8) });
+}
+std::vector<arma::mat>
+serial(const PolytopeCandidate & p,
+		const PolytopeExtender::Options & opts = PolytopeExtender::Options()) {
+	std::vector<arma::mat> result;
+	PolytopeExtender ext(p, opts);
+	while(ext.has_next()) {
+		result.push_back(ext.next().gram());
+	}
+	return result;
+}
+}
+TEST(ParallelExtender, Ordered) {
+	Angles::get().set_angles({2, 3, 4, 5, 8});
+	PolytopeCandidate q = hyperbolic_b4();
+	ASSERT_TRUE(q.valid());
+	std::vector<arma::mat> expected = serial(q);
+	ASSERT_FALSE(expected.empty());
+
+	ParallelExtender::Options opts;
+	opts.grain = 16;
+	opts.ordered = true;
+	ParallelExtender ext(q, opts);
+	ThreadPool pool(4);
+	std::vector<arma::mat> found;
+	ext.run(pool, [&found](const PolytopeCandidate & p) {
+				found.push_back(p.gram());
+			});
+	ASSERT_EQ(expected.size(), found.size());
+	for(std::size_t i = 0; i < found.size(); ++i) {
+		for(arma::uword j = 0; j < found[i].size(); ++j) {
+			EXPECT_DOUBLE_EQ(expected[i](j), found[i](j));
+		}
+	}
+}
+TEST(ParallelExtender, RestrictedDomains) {
+	Angles::get().set_angles({2, 3, 4, 5, 8});
+	PolytopeCandidate q = hyperbolic_b4();
+	ASSERT_TRUE(q.valid());
+	ParallelExtender::Options opts;
+	/* The first entry is restricted, while the others allow angles outside
+	 * Angles, so the ranks differ from those of the default domains. */
+	const Angles::PiSubmultiples wide = { 2, 3, 4, 5, 6, 8, 10, 12 };
+	opts.extender.domains = InnerProductVectors::label_domains({ { 2, 3 },
+			wide, wide, wide });
+	std::vector<arma::mat> expected = serial(q, opts.extender);
+	ASSERT_FALSE(expected.empty());
+
+	opts.grain = 4;
+	opts.ordered = true;
+	ParallelExtender ext(q, opts);
+	ThreadPool pool(4);
+	std::vector<arma::mat> found;
+	ext.run(pool, [&found](const PolytopeCandidate & p) {
+				found.push_back(p.gram());
+			});
+	ASSERT_EQ(expected.size(), found.size());
+	for(std::size_t i = 0; i < found.size(); ++i) {
+		for(arma::uword j = 0; j < found[i].size(); ++j) {
+			EXPECT_DOUBLE_EQ(expected[i](j), found[i](j));
+		}
+	}
+}
+TEST(ParallelExtender, Unordered) {
+	Angles::get().set_angles({2, 3, 4, 5, 8});
+	PolytopeCandidate q = hyperbolic_b4();
+	ASSERT_TRUE(q.valid());
+	std::size_t expected = serial(q).size();
+
+	ParallelExtender::Options opts;
+	opts.grain = 16;
+	ParallelExtender ext(q, opts);
+	ThreadPool pool(4);
+	std::size_t count = 0;
+	ext.run(pool, [&count](const PolytopeCandidate & p) {
+				EXPECT_TRUE(p.valid());
+				++count;
+			});
+	EXPECT_EQ(expected, count);
+	/* Running again gives the same extensions. */
+	count = 0;
+	ext.run(pool, [&count](const PolytopeCandidate &) { ++count; });
+	EXPECT_EQ(expected, count);
+}
+TEST(ParallelExtender, Symmetry) {
+	Angles::get().set_angles({2, 3, 4, 5, 8});
+	PolytopeCandidate q = hyperbolic_b4();
+	ASSERT_TRUE(q.valid());
+	ParallelExtender::Options opts;
+	opts.extender.symmetry = true;
+	std::vector<arma::mat> expected = serial(q, opts.extender);
+	ASSERT_FALSE(expected.empty());
+
+	opts.grain = 16;
+	opts.ordered = true;
+	ParallelExtender ext(q, opts);
+	ThreadPool pool(4);
+	std::vector<arma::mat> found;
+	ext.run(pool, [&found](const PolytopeCandidate & p) {
+				found.push_back(p.gram());
+			});
+	ASSERT_EQ(expected.size(), found.size());
+	for(std::size_t i = 0; i < found.size(); ++i) {
+		for(arma::uword j = 0; j < found[i].size(); ++j) {
+			EXPECT_DOUBLE_EQ(expected[i](j), found[i](j));
+		}
+	}
+}
+TEST(ParallelExtender, SinkThrows) {
+	Angles::get().set_angles({2, 3, 4, 5, 8});
+	PolytopeCandidate q = hyperbolic_b4();
+	ASSERT_TRUE(q.valid());
+	std::size_t expected = serial(q).size();
+	ASSERT_LT(3u, expected);
+
+	ParallelExtender::Options opts;
+	opts.grain = 16;
+	ParallelExtender ext(q, opts);
+	ThreadPool pool(4);
+	std::size_t count = 0;
+	EXPECT_THROW(ext.run(pool, [&count](const PolytopeCandidate &) {
+					if(++count == 3) {
+						throw std::runtime_error("sink failed");
+					}
+				}), std::runtime_error);
+	EXPECT_LE(3u, count);
+	/* The pool and extender can still be used. */
+	count = 0;
+	ext.run(pool, [&count](const PolytopeCandidate &) { ++count; });
+	EXPECT_EQ(expected, count);
+}
+}
@@ -0,0 +1,125 @@
+/*
+ * polytope_candidate_n_test.cc
+ * Copyright 2016 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "polytope_candidate_n.h"
+
+#include "polytope_check.h"
+
+#include <gtest/gtest.h>
+
+namespace ptope {
+namespace {
+constexpr double error = 1e-15;
+double min_cos_angle(uint mult) {
+	return -std::cos(arma::datum::pi/mult);
+}
+/* The Esselmann example, extended once into hyperbolic space. */
+PolytopeCandidate
+esselmann_start() {
+	PolytopeCandidate p({ { 1, -.5, 0, 0 },
+												{ -.5, 1, min_cos_angle(4), 0 },
+												{ 0, min_cos_angle(4), 1, -.5 },
+												{ 0, 0, -.5, 1 } });
+	return p.extend_by_inner_products({ 0, 0, 0, min_cos_angle(8) });
+}
+}
+TEST(PolytopeCandidateN, RoundTrip) {
+	const PolytopeCandidate q = esselmann_start();
+	PolytopeCandidateN<4, 8> fixed(q);
+	ASSERT_TRUE(fixed.valid());
+	EXPECT_EQ(5u, fixed.size());
+	const PolytopeCandidate back = fixed.to_candidate();
+	EXPECT_TRUE(back.hyperbolic());
+	EXPECT_EQ(4u, back.real_dimension());
+	ASSERT_EQ(q.gram().n_elem, back.gram().n_elem);
+	for(arma::uword i = 0; i < q.gram().n_elem; ++i) {
+		EXPECT_EQ(q.gram()[i], back.gram()[i]);
+	}
+	const arma::mat & vectors = q.vector_family().underlying_matrix();
+	const arma::mat & back_vectors = back.vector_family().underlying_matrix();
+	ASSERT_EQ(vectors.n_elem, back_vectors.n_elem);
+	for(arma::uword i = 0; i < vectors.n_elem; ++i) {
+		EXPECT_EQ(vectors[i], back_vectors[i]);
+	}
+}
+TEST(PolytopeCandidateN, ExtendMatchesDynamic) {
+	const PolytopeCandidate q = esselmann_start();
+	const PolytopeCandidate r =
+		q.extend_by_inner_products({ min_cos_angle(8), 0, 0, 0 });
+	ASSERT_TRUE(r.valid());
+	PolytopeCandidateN<4, 8> fixed(q);
+	PolytopeCandidateN<4, 8> extended;
+	ASSERT_TRUE(fixed.extend_by_vector(extended, r.vector_family().get(5)));
+	EXPECT_EQ(5u, fixed.size());
+	ASSERT_EQ(6u, extended.size());
+	for(std::size_t j = 0; j < 6; ++j) {
+		for(std::size_t i = 0; i < 6; ++i) {
+			EXPECT_EQ(r.gram()(i, j), extended.gram(i, j));
+		}
+	}
+	PolytopeCheck chk;
+	EXPECT_TRUE(chk(extended.to_candidate()));
+}
+TEST(PolytopeCandidateN, ConvertedExtends) {
+	/* The basis of the converted candidate must give the same new vectors. */
+	const PolytopeCandidate q = esselmann_start();
+	const PolytopeCandidate converted = PolytopeCandidateN<4, 8>(q).to_candidate();
+	const arma::vec products = { min_cos_angle(8), 0, 0, 0 };
+	const PolytopeCandidate expected = q.extend_by_inner_products(products);
+	const PolytopeCandidate result = converted.extend_by_inner_products(products);
+	ASSERT_TRUE(result.valid());
+	arma::mat diff = result.gram() - expected.gram();
+	for(const double & val : diff) {
+		EXPECT_NEAR(0.0, val, error);
+	}
+}
+TEST(PolytopeCandidateN, Full) {
+	const PolytopeCandidate q = esselmann_start();
+	PolytopeCandidateN<4, 5> fixed(q);
+	ASSERT_TRUE(fixed.valid());
+	EXPECT_FALSE(fixed.extend_by_vector(q.vector_family().get(0)));
+	EXPECT_EQ(5u, fixed.size());
+	PolytopeCandidateN<4, 4> small(q);
+	EXPECT_FALSE(small.valid());
+}
+TEST(PolytopeCandidateN, WrongVectorSize) {
+	const PolytopeCandidate q = esselmann_start();
+	PolytopeCandidateN<4, 8> fixed(q);
+	ASSERT_TRUE(fixed.valid());
+	PolytopeCandidateN<4, 8> result(fixed);
+	arma::vec short_vec(4);
+	short_vec.zeros();
+	arma::vec long_vec(6);
+	long_vec.zeros();
+	for(const arma::vec & vec : { short_vec, long_vec }) {
+		EXPECT_FALSE(fixed.extend_by_vector(result, vec));
+		EXPECT_EQ(5u, result.size());
+		EXPECT_FALSE(fixed.extend_by_vector(vec));
+		EXPECT_EQ(5u, fixed.size());
+	}
+	EXPECT_TRUE(fixed.extend_by_vector(q.vector_family().get(0)));
+	EXPECT_EQ(6u, fixed.size());
+}
+TEST(PolytopeCandidateN, WrongDimension) {
+	const PolytopeCandidate q = esselmann_start();
+	PolytopeCandidateN<3, 8> fixed;
+	EXPECT_FALSE(fixed.assign(q));
+	EXPECT_FALSE(fixed.valid());
+	/* Candidates still in real space cannot be stored. */
+	PolytopeCandidateN<4, 8> real;
+	EXPECT_FALSE(real.assign(PolytopeCandidate({ { 1, -.5 }, { -.5, 1 } })));
+}
+}
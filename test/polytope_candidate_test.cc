@@ -19,6 +19,8 @@
 
 #include <gtest/gtest.h>
 
+#include <thread>
+
 namespace ptope {
 namespace {
 constexpr double error = 1e-15;
@@ -100,5 +102,151 @@ TEST(PolytopeCandidate, SaveLoad) {
 	}
 	EXPECT_EQ(p.valid(), q.valid());
 }
+namespace {
+/* Extend the candidate by a fixed set of inner product vectors, storing each
+ * extended gram matrix. */
+void
+extend_all(const PolytopeCandidate & p, const std::vector<arma::vec> & inner,
+		std::vector<arma::mat> & out) {
+	PolytopeCandidate::Workspace ws;
+	PolytopeCandidate result;
+	for(int rep = 0; rep < 50; ++rep) {
+		out.clear();
+		for(const arma::vec & v : inner) {
+			if(p.extend_by_inner_products(result, v, ws)) {
+				out.push_back(result.gram());
+			}
+		}
+	}
+}
 }
+TEST(PolytopeCandidate, ThreadedExtend) {
+	PolytopeCandidate b(elliptic_factory::type_b(4));
+	PolytopeCandidate q = b.extend_by_inner_products({ 0, min_cos_angle(8), 0, 0 });
+	ASSERT_TRUE(q.valid());
+	PolytopeCandidate r = q.extend_by_inner_products({ 0, 0, 0, min_cos_angle(8) });
+	ASSERT_TRUE(r.valid());
+	r.rebase_vectors({ 1, 2, 4, 5 });
+	PolytopeCandidate a(elliptic_factory::type_a(4));
+	PolytopeCandidate s = a.extend_by_inner_products({ min_cos_angle(5), -.5, 0, 0 });
+	ASSERT_TRUE(s.valid());
 
+	std::vector<arma::vec> inner;
+	const double prods[] = { 0, -.5, min_cos_angle(4), min_cos_angle(5) };
+	for(const double & x : prods) {
+		for(const double & y : prods) {
+			inner.push_back({ x, y, 0, min_cos_angle(8) });
+			inner.push_back({ y, -.5, x, 0 });
+		}
+	}
+	std::vector<arma::mat> serial_r, serial_s, thread_r, thread_s;
+	extend_all(r, inner, serial_r);
+	extend_all(s, inner, serial_s);
+	ASSERT_FALSE(serial_r.empty());
+	ASSERT_FALSE(serial_s.empty());
+
+	PolytopeCandidate r_copy(r);
+	PolytopeCandidate s_copy(s);
+	std::thread t1(extend_all, std::cref(r_copy), std::cref(inner),
+			std::ref(thread_r));
+	std::thread t2(extend_all, std::cref(s_copy), std::cref(inner),
+			std::ref(thread_s));
+	t1.join();
+	t2.join();
+
+	ASSERT_EQ(serial_r.size(), thread_r.size());
+	for(std::size_t i = 0; i < serial_r.size(); ++i) {
+		ASSERT_EQ(serial_r[i].size(), thread_r[i].size());
+		for(arma::uword j = 0; j < serial_r[i].size(); ++j) {
+			EXPECT_DOUBLE_EQ(serial_r[i](j), thread_r[i](j));
+		}
+	}
+	ASSERT_EQ(serial_s.size(), thread_s.size());
+	for(std::size_t i = 0; i < serial_s.size(); ++i) {
+		ASSERT_EQ(serial_s[i].size(), thread_s[i].size());
+		for(arma::uword j = 0; j < serial_s[i].size(); ++j) {
+			EXPECT_DOUBLE_EQ(serial_s[i](j), thread_s[i](j));
+		}
+	}
+}
+namespace {
+/* Check that extend_batch agrees with extending by each column in turn. */
+void
+check_batch(const PolytopeCandidate & p, const arma::mat & inner) {
+	boost::dynamic_bitset<> ok;
+	arma::mat vectors;
+	std::size_t n_valid = p.extend_batch(inner, ok, vectors);
+	ASSERT_EQ(inner.n_cols, ok.size());
+	EXPECT_EQ(ok.count(), n_valid);
+	PolytopeCandidate single;
+	PolytopeCandidate batch;
+	for(arma::uword col = 0; col < inner.n_cols; ++col) {
+		bool valid = p.extend_by_inner_products(single, inner.col(col));
+		ASSERT_EQ(valid, ok[col]);
+		if(valid) {
+			p.extend_by_vector(batch, vectors.unsafe_col(col));
+			ASSERT_EQ(single.gram().size(), batch.gram().size());
+			for(arma::uword j = 0; j < single.gram().size(); ++j) {
+				EXPECT_NEAR(single.gram()(j), batch.gram()(j), 1e-12);
+			}
+		}
+	}
+}
+}
+TEST(PolytopeCandidate, ExtendBatch) {
+	PolytopeCandidate b(elliptic_factory::type_b(4));
+	PolytopeCandidate q = b.extend_by_inner_products({ 0, min_cos_angle(8), 0, 0 });
+	ASSERT_TRUE(q.valid());
+	PolytopeCandidate a(elliptic_factory::type_a(4));
+	PolytopeCandidate s = a.extend_by_inner_products({ min_cos_angle(5), -.5, 0, 0 });
+	ASSERT_TRUE(s.valid());
+
+	const double prods[] = { 0, -.5, min_cos_angle(4), min_cos_angle(5) };
+	arma::mat inner(4, 32);
+	arma::uword col = 0;
+	for(const double & x : prods) {
+		for(const double & y : prods) {
+			inner.col(col++) = arma::vec({ x, y, 0, min_cos_angle(8) });
+			inner.col(col++) = arma::vec({ y, -.5, x, 0 });
+		}
+	}
+	check_batch(b, inner);
+	check_batch(q, inner);
+	check_batch(s, inner);
+}
+TEST(PolytopeCandidate, Incremental) {
+	PolytopeCandidate b(elliptic_factory::type_b(4));
+	PolytopeCandidate q = b.extend_by_inner_products({ 0, min_cos_angle(8), 0, 0 });
+	ASSERT_TRUE(q.valid());
+	PolytopeCandidate a(elliptic_factory::type_a(4));
+	PolytopeCandidate s = a.extend_by_inner_products({ min_cos_angle(5), -.5, 0, 0 });
+	ASSERT_TRUE(s.valid());
+
+	const double prods[] = { 0, -.5, min_cos_angle(4), min_cos_angle(5) };
+	for(const PolytopeCandidate * p : { &b, &q, &s }) {
+		PolytopeCandidate::Incremental inc(*p);
+		arma::vec inner = { 0, 0, 0, 0 };
+		inc.reset(inner);
+		PolytopeCandidate single;
+		std::size_t n_valid = 0;
+		/* Walk through the inner products changing one entry at a time. */
+		for(arma::uword step = 0; step < 64; ++step) {
+			const arma::uword index = step % 4;
+			const double value = prods[(step / 4 + index) % 4];
+			inc.update(index, value - inner(index));
+			inner(index) = value;
+			bool valid = p->extend_by_inner_products(single, inner);
+			ASSERT_EQ(valid, inc.compute());
+			if(valid) {
+				++n_valid;
+				const arma::vec & v = single.vector_family().get(p->vector_family().size());
+				ASSERT_EQ(v.size(), inc.vector().size());
+				for(arma::uword i = 0; i < v.size(); ++i) {
+					EXPECT_NEAR(v(i), inc.vector()(i), 1e-12);
+				}
+			}
+		}
+		EXPECT_LT(0u, n_valid);
+	}
+}
+}
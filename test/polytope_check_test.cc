@@ -20,9 +20,14 @@
 #include "calc.h"
 #include "elliptic_factory.h"
 #include "parabolic_check.h"
+#include "polytope_extender.h"
+#include "thread_pool.h"
 
 #include <gtest/gtest.h>
 
+#include <cmath>
+#include <thread>
+
 namespace ptope {
 using ptope::calc::min_cos_angle;
 TEST(PolytopeCheck, EsselmannExample) {
@@ -35,6 +40,225 @@ TEST(PolytopeCheck, EsselmannExample) {
 	PolytopeCheck chk;
 	EXPECT_TRUE(chk(r));
 }
+TEST(PolytopeCheck, EdgesSearchedOnce) {
+	PolytopeCandidate p({ { 1, -.5, 0, 0 }, 
+												{ -.5, 1, min_cos_angle(4), 0 }, 
+												{ 0, min_cos_angle(4), 1, -.5 }, 
+												{ 0, 0, -.5, 1 } });
+	auto q = p.extend_by_inner_products({ 0, 0, 0, min_cos_angle(8) });
+	auto r = q.extend_by_inner_products({ min_cos_angle(8), 0, 0, 0 });
+	PolytopeCheck chk;
+	ASSERT_TRUE(chk(r));
+	const std::size_t dim = r.real_dimension();
+	const PolytopeCheck::Stats & stats = chk.stats();
+	/* The polytope is simple, so each vertex is on dim edges, each of which is
+	 * searched exactly once. */
+	EXPECT_EQ(stats.vertices * dim, 2 * stats.edges_searched);
+	EXPECT_LT(0u, stats.potrf_saved);
+	/* Every vertex but the first is reached along an edge, which is not queued
+	 * again from that vertex. */
+	EXPECT_EQ(dim + (stats.vertices - 1) * (dim - 1),
+			stats.edges_searched + stats.potrf_saved);
+}
+TEST(PolytopeCheck, ClassifiedFromLabels) {
+	PolytopeCandidate p({ { 1, -.5, 0, 0 }, 
+												{ -.5, 1, min_cos_angle(4), 0 }, 
+												{ 0, min_cos_angle(4), 1, -.5 }, 
+												{ 0, 0, -.5, 1 } });
+	auto q = p.extend_by_inner_products({ 0, 0, 0, min_cos_angle(8) });
+	auto r = q.extend_by_inner_products({ min_cos_angle(8), 0, 0, 0 });
+	PolytopeCheck chk;
+	ASSERT_TRUE(chk(r));
+	/* Every entry is a known angle, so no factorisations are needed. */
+	EXPECT_LT(0u, chk.stats().classified);
+	EXPECT_EQ(0u, chk.stats().potrf_calls);
+}
+TEST(PolytopeCheck, NumericMatchesLabels) {
+	Angles::get().set_angles({2, 3, 4, 5, 8});
+	PolytopeCandidate esselmann({ { 1, -.5, 0, 0 },
+			{ -.5, 1, min_cos_angle(4), 0 },
+			{ 0, min_cos_angle(4), 1, -.5 },
+			{ 0, 0, -.5, 1 } });
+	auto q = esselmann.extend_by_inner_products({ 0, 0, 0, min_cos_angle(8) });
+	auto r = q.extend_by_inner_products({ min_cos_angle(8), 0, 0, 0 });
+	PolytopeCandidate lanner({ { 1, -.5, 0 }, { -.5, 1, min_cos_angle(5) },
+			{ 0, min_cos_angle(5), 1 }});
+	PolytopeCandidate a4(elliptic_factory::type_a(4));
+	auto odd = a4.extend_by_inner_products({ min_cos_angle(5), -.5, 0, 0});
+	const std::vector<PolytopeCandidate> candidates = { q, r,
+		lanner.extend_by_inner_products({ 0, 0, -.5 }),
+		lanner.extend_by_inner_products({ -.5, -.5, -.5 }), odd,
+		odd.extend_by_inner_products({0, -.5, min_cos_angle(5), -.5 }) };
+	std::vector<bool> expected;
+	for(const PolytopeCandidate & p : candidates) {
+		ASSERT_TRUE(p.valid());
+		PolytopeCheck chk;
+		expected.push_back(chk(p));
+	}
+	EXPECT_TRUE(expected[1]);
+	EXPECT_TRUE(expected[2]);
+	/* Without labels for the angles pi/4, pi/5 and pi/8 the classifier cannot
+	 * decide the vertices containing them, so they are factored instead. */
+	Angles::get().set_angles({2, 3});
+	for(std::size_t i = 0; i < candidates.size(); ++i) {
+		PolytopeCheck chk;
+		EXPECT_EQ(expected[i], chk(candidates[i])) << "candidate " << i;
+		EXPECT_LT(0u, chk.stats().potrf_calls) << "candidate " << i;
+	}
+	Angles::get().set_angles({2, 3, 4, 5, 8});
+}
+TEST(PolytopeCheck, AdjacencyFilter) {
+	Angles::get().set_angles({2, 3, 4, 5, 8});
+	/* The right angled pentagon, where sides which do not meet are
+	 * ultraparallel, at distance acosh of the golden ratio. */
+	const double dotted = -(1 + std::sqrt(5.0)) / 2;
+	PolytopeCandidate right_angles({ { 1, 0 }, { 0, 1 } });
+	auto pentagon = right_angles.extend_by_inner_products({ dotted, 0 })
+		.extend_by_inner_products({ dotted, dotted })
+		.extend_by_inner_products({ 0, dotted });
+	ASSERT_TRUE(pentagon.valid());
+	/* A triangle with a vertex at infinity, where two sides are parallel. */
+	auto ideal = right_angles.extend_by_inner_products({ -.5, -1 });
+	ASSERT_TRUE(ideal.valid());
+
+	PolytopeCheck chk;
+	PolytopeCheck unfiltered;
+	unfiltered.set_adjacency_filter(false);
+	EXPECT_TRUE(chk(pentagon));
+	/* Every vertex of the pentagon is right angled, so can be classified from
+	 * its labels. The unlabelled ultraparallel pairs would need factoring, so
+	 * none of them are tested. */
+	EXPECT_EQ(0u, chk.stats().potrf_calls);
+	EXPECT_TRUE(unfiltered(pentagon));
+	EXPECT_LT(0u, unfiltered.stats().potrf_calls);
+	EXPECT_EQ(chk.stats().vertices, unfiltered.stats().vertices);
+
+	EXPECT_FALSE(chk(ideal));
+	EXPECT_EQ(0u, chk.stats().potrf_calls);
+	EXPECT_FALSE(unfiltered(ideal));
+}
+TEST(PolytopeCheck, Extension) {
+	PolytopeCandidate p({ { 1, -.5, 0, 0 }, 
+												{ -.5, 1, min_cos_angle(4), 0 }, 
+												{ 0, min_cos_angle(4), 1, -.5 }, 
+												{ 0, 0, -.5, 1 } });
+	auto q = p.extend_by_inner_products({ 0, 0, 0, min_cos_angle(8) });
+	auto r = q.extend_by_inner_products({ min_cos_angle(8), 0, 0, 0 });
+	PolytopeCheck chk;
+	PolytopeCheck::State state;
+	EXPECT_FALSE(chk(q, state));
+	EXPECT_FALSE(state.compact());
+	const std::size_t parent_edges = chk.stats().edges_searched;
+	EXPECT_TRUE(chk.check_extension(r, state));
+	const std::size_t extension_edges = chk.stats().edges_searched;
+	EXPECT_TRUE(chk(r));
+	/* The edges searched for the parent are not searched again. */
+	EXPECT_EQ(chk.stats().edges_searched + 1, parent_edges + extension_edges);
+	/* A state from a different candidate falls back to a full check. */
+	EXPECT_TRUE(chk.check_extension(r, PolytopeCheck::State()));
+}
+TEST(PolytopeCheck, ExtensionOfOtherParent) {
+	PolytopeCandidate p({ { 1, -.5, 0, 0 }, 
+												{ -.5, 1, min_cos_angle(4), 0 }, 
+												{ 0, min_cos_angle(4), 1, -.5 }, 
+												{ 0, 0, -.5, 1 } });
+	auto q = p.extend_by_inner_products({ 0, 0, 0, min_cos_angle(8) });
+	auto r = q.extend_by_inner_products({ min_cos_angle(8), 0, 0, 0 });
+	PolytopeCheck chk;
+	PolytopeCheck full;
+	PolytopeCheck::State state;
+	EXPECT_FALSE(chk(q, state));
+	/* The same facets in a different order do not extend q, so its vertices
+	 * cannot be reused. */
+	PolytopeCandidate rebased(r);
+	rebased.rebase_vectors({ 1, 2, 4, 5 });
+	EXPECT_EQ(full(rebased), chk.check_extension(rebased, state));
+	EXPECT_EQ(full.stats().edges_searched, chk.stats().edges_searched);
+	EXPECT_EQ(full.stats().vertices, chk.stats().vertices);
+}
+TEST(PolytopeCheck, ExtensionMatchesFull) {
+	PolytopeCandidate p(elliptic_factory::type_b(4));
+	PolytopeExtender children(p);
+	PolytopeCheck chk;
+	PolytopeCheck full;
+	PolytopeCheck::State seed_state;
+	PolytopeCheck::State state;
+	PolytopeCheck::State child_state;
+	/* The seed gives no vertex to start the search from. */
+	EXPECT_FALSE(chk(p, seed_state));
+	for(int i = 0; i < 10 && children.has_next(); ++i) {
+		auto child = children.next();
+		EXPECT_EQ(full(child), chk.check_extension(child, seed_state, state));
+		PolytopeExtender grandchildren(child);
+		while(grandchildren.has_next()) {
+			auto grandchild = grandchildren.next();
+			EXPECT_EQ(full(grandchild),
+					chk.check_extension(grandchild, state, child_state));
+			EXPECT_EQ(full.stats().vertices, chk.stats().vertices);
+			EXPECT_EQ(child_state.vertices(), chk.stats().vertices);
+		}
+	}
+}
+namespace {
+/* Children and grandchildren of the first few children of B4. */
+std::vector<PolytopeCandidate>
+b4_descendants() {
+	std::vector<PolytopeCandidate> result;
+	PolytopeExtender children(PolytopeCandidate(elliptic_factory::type_b(4)));
+	for(int i = 0; i < 10 && children.has_next(); ++i) {
+		result.push_back(children.next());
+		PolytopeExtender grandchildren(result.back());
+		while(grandchildren.has_next()) {
+			result.push_back(grandchildren.next());
+		}
+	}
+	return result;
+}
+}
+TEST(PolytopeCheck, ParallelMatchesSerial) {
+	ThreadPool pool(4);
+	PolytopeCheck serial;
+	PolytopeCheck parallel;
+	/* Search every edge in parallel, however few are waiting. */
+	parallel.set_thread_pool(&pool, 1);
+	for(const PolytopeCandidate & p : b4_descendants()) {
+		EXPECT_EQ(serial(p), parallel(p));
+		EXPECT_EQ(serial.stats().vertices, parallel.stats().vertices);
+	}
+	PolytopeCandidate p(elliptic_factory::type_e(8));
+	auto q = p.extend_by_inner_products({ min_cos_angle(5), 0, 0, 0, 0, 0, 0, 0 });
+	auto r = q.extend_by_inner_products({ 0, 0, 0, 0, 0, 0, 0, min_cos_angle(5) });
+	r.rebase_vectors({ 0, 1, 2, 4, 5, 6, 7, 8 });
+	auto s = r.extend_by_inner_products({ 0, 0, 0, 0, -.5, 0, 0, 0 });
+	ASSERT_TRUE(s.valid());
+	EXPECT_TRUE(serial(s));
+	EXPECT_TRUE(parallel(s));
+	EXPECT_EQ(serial.stats().vertices, parallel.stats().vertices);
+}
+TEST(PolytopeCheck, Concurrent) {
+	const std::vector<PolytopeCandidate> candidates = b4_descendants();
+	std::vector<bool> expected;
+	PolytopeCheck chk;
+	for(const PolytopeCandidate & p : candidates) {
+		expected.push_back(chk(p));
+	}
+	std::atomic<std::size_t> mismatches(0);
+	std::vector<std::thread> threads;
+	for(int t = 0; t < 4; ++t) {
+		threads.emplace_back([&candidates, &expected, &mismatches]() {
+					PolytopeCheck local;
+					for(std::size_t i = 0; i < candidates.size(); ++i) {
+						if(local(candidates[i]) != expected[i]) {
+							++mismatches;
+						}
+					}
+				});
+	}
+	for(std::thread & t : threads) {
+		t.join();
+	}
+	EXPECT_EQ(0u, mismatches);
+}
 TEST(PolytopeCheck, LannerExample) {
 	PolytopeCandidate p({ { 1, -.5, 0 }, { -.5, 1, min_cos_angle(5) },
 			{ 0, min_cos_angle(5), 1 }});
@@ -18,6 +18,8 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+
 #include "angles.h"
 #include "calc.h"
 #include "elliptic_factory.h"
@@ -32,6 +34,7 @@
 #include "construct_iterator.h"
 #include "polytope_check.h"
 #include "elliptic_generator.h"
+#include "number_dotted_check.h"
 
 typedef ptope::StackedIterator<ptope::PolytopeRebaser, ptope::PolytopeExtender,
 					ptope::PolytopeCandidate> PCtoL3;
@@ -187,5 +190,329 @@ TEST(ListIterator, Gen4Dim) {
 	}
 	EXPECT_TRUE(found);
 }
+namespace {
+/* Check that pruning the inner product vectors gives exactly the same
+ * extensions, in the same order, as the full enumeration. Returns the number
+ * of subtrees pruned. */
+std::size_t
+check_pruned(const PolytopeCandidate & p) {
+	PolytopeExtender::Options full_opts;
+	full_opts.prune = false;
+	PolytopeExtender full(p, full_opts);
+	PolytopeExtender pruned(p);
+	std::size_t count = 0;
+	while(full.has_next()) {
+		const PolytopeCandidate & f = full.next();
+		EXPECT_TRUE(pruned.has_next());
+		if(!pruned.has_next()) {
+			return pruned.pruned_subtrees();
+		}
+		const PolytopeCandidate & g = pruned.next();
+		EXPECT_EQ(f.gram().size(), g.gram().size());
+		for(arma::uword i = 0; i < f.gram().size(); ++i) {
+			EXPECT_DOUBLE_EQ(f.gram()(i), g.gram()(i));
+		}
+		++count;
+	}
+	EXPECT_FALSE(pruned.has_next());
+	EXPECT_EQ(0u, full.pruned_subtrees());
+	return pruned.pruned_subtrees();
+}
+}
+TEST(PolytopeExtender, PrunedMatchesFull) {
+	using ptope::calc::min_cos_angle;
+	Angles::get().set_angles({2, 3, 4, 5, 8});
+	EXPECT_LT(0u, check_pruned(elliptic_factory::type_a(3)));
+	check_pruned(elliptic_factory::type_b(4));
+
+	PolytopeCandidate p({{ 1, -.5, 0 }, {-.5, 1, -.5 }, { 0, -.5, 1 } });
+	check_pruned(p.extend_by_inner_products({ -.5, -.5, -.5}));
+
+	PolytopeCandidate b(elliptic_factory::type_b(4));
+	auto q = b.extend_by_inner_products({ 0, 0, 0, min_cos_angle(8) });
+	ASSERT_TRUE(q.valid());
+	EXPECT_LT(0u, check_pruned(q));
+	auto r = q.extend_by_inner_products({ 0, min_cos_angle(8), 0, 0 });
+	ASSERT_TRUE(r.valid());
+	check_pruned(r);
+	r.rebase_vectors({ 1, 2, 4, 5 });
+	check_pruned(r);
+}
+TEST(PolytopeExtender, GrayMatchesLexicographic) {
+	using ptope::calc::min_cos_angle;
+	Angles::get().set_angles({2, 3, 4, 5, 8});
+	PolytopeCandidate b(elliptic_factory::type_b(4));
+	auto q = b.extend_by_inner_products({ 0, 0, 0, min_cos_angle(8) });
+	ASSERT_TRUE(q.valid());
+	for(const PolytopeCandidate & p : { b, q }) {
+		PolytopeExtender::Options gray_opts;
+		gray_opts.gray_code = true;
+		PolytopeExtender lex(p);
+		PolytopeExtender gray(p, gray_opts);
+		std::set<arma::vec, comparator::VecLess> lex_prods;
+		std::set<arma::vec, comparator::VecLess> gray_prods;
+		/* The products of the new vector with the basis identify each extension.
+		 * Rounding them stops tiny differences from giving distinct entries. */
+		const arma::uword dim = p.real_dimension();
+		while(lex.has_next()) {
+			arma::vec v = lex.next().gram().tail_cols(1);
+			lex_prods.insert(arma::round(v.head(dim) * 1e8));
+		}
+		while(gray.has_next()) {
+			arma::vec v = gray.next().gram().tail_cols(1);
+			gray_prods.insert(arma::round(v.head(dim) * 1e8));
+		}
+		EXPECT_FALSE(lex_prods.empty());
+		EXPECT_EQ(lex_prods.size(), gray_prods.size());
+		for(const arma::vec & v : gray_prods) {
+			EXPECT_EQ(1u, lex_prods.count(v));
+		}
+	}
+}
+namespace {
+/* Collect the gram matrices of all extensions. */
+std::vector<arma::mat>
+extend_all(const PolytopeCandidate & p, const PolytopeExtender::Options & opts) {
+	std::vector<arma::mat> result;
+	PolytopeExtender ext(p, opts);
+	while(ext.has_next()) {
+		result.push_back(ext.next().gram());
+	}
+	return result;
 }
+void
+expect_same(const std::vector<arma::mat> & a, const std::vector<arma::mat> & b) {
+	ASSERT_EQ(a.size(), b.size());
+	for(std::size_t i = 0; i < a.size(); ++i) {
+		ASSERT_EQ(a[i].size(), b[i].size());
+		for(arma::uword j = 0; j < a[i].size(); ++j) {
+			EXPECT_NEAR(a[i](j), b[i](j), 1e-10);
+		}
+	}
+}
+}
+TEST(PolytopeExtender, Ranges) {
+	using ptope::calc::min_cos_angle;
+	Angles::get().set_angles({2, 3, 4, 5, 8});
+	PolytopeCandidate b(elliptic_factory::type_b(4));
+	auto q = b.extend_by_inner_products({ 0, 0, 0, min_cos_angle(8) });
+	ASSERT_TRUE(q.valid());
+	for(bool gray : { false, true }) {
+		PolytopeExtender::Options opts;
+		opts.gray_code = gray;
+		std::vector<arma::mat> full = extend_all(q, opts);
+		ASSERT_FALSE(full.empty());
+
+		InnerProductVectors ipv(q.real_dimension());
+		std::vector<arma::mat> chunked;
+		for(std::size_t c = 0; c < 3; ++c) {
+			opts.range = ipv.chunk(c, 3);
+			std::vector<arma::mat> part = extend_all(q, opts);
+			chunked.insert(chunked.end(), part.begin(), part.end());
+		}
+		expect_same(full, chunked);
 
+		/* Stop part way through, then resume from where the first extender got
+		 * to. */
+		opts.range = InnerProductVectors::Range();
+		PolytopeExtender first(q, opts);
+		std::vector<arma::mat> resumed;
+		for(std::size_t i = 0; i < full.size() / 2 && first.has_next(); ++i) {
+			resumed.push_back(first.next().gram());
+		}
+		opts.range = InnerProductVectors::Range(first.resume_rank(), ipv.total());
+		std::vector<arma::mat> rest = extend_all(q, opts);
+		resumed.insert(resumed.end(), rest.begin(), rest.end());
+		expect_same(full, resumed);
+	}
+}
+TEST(PolytopeExtender, Symmetry) {
+	PolytopeCandidate p(elliptic_factory::type_a(3));
+	Angles::get().set_angles({2, 3, 4, 5, 8});
+	PolytopeExtender::Options opts;
+	opts.symmetry = true;
+	PolytopeExtender ext(p, opts);
+	int count = 0;
+	while(ext.has_next()) {
+		ext.next();
+		++count;
+	}
+	/* The flip of A3 pairs up all but the symmetric extensions. */
+	EXPECT_LT(115 / 2, count);
+	EXPECT_GT(115, count);
+}
+TEST(PolytopeExtender, GraySymmetry) {
+	Angles::get().set_angles({2, 3, 4, 5, 8});
+	PolytopeCandidate a(elliptic_factory::type_a(3));
+	PolytopeCandidate d(elliptic_factory::type_d(4));
+	for(const PolytopeCandidate & p : { a, d }) {
+		PolytopeExtender::Options opts;
+		opts.symmetry = true;
+		std::vector<arma::mat> lex = extend_all(p, opts);
+		opts.gray_code = true;
+		PolytopeExtender gray(p, opts);
+		/* The same representatives are kept in either order. */
+		std::set<arma::vec, comparator::VecLess> lex_prods;
+		const arma::uword dim = p.real_dimension();
+		for(const arma::mat & gram : lex) {
+			arma::vec v = gram.tail_cols(1);
+			lex_prods.insert(arma::round(v.head(dim) * 1e8));
+		}
+		std::size_t count = 0;
+		while(gray.has_next()) {
+			arma::vec v = gray.next().gram().tail_cols(1);
+			EXPECT_EQ(1u, lex_prods.count(arma::round(v.head(dim) * 1e8)));
+			++count;
+		}
+		EXPECT_EQ(lex.size(), count);
+		EXPECT_LT(0u, gray.pruned_subtrees());
+		opts.symmetry = false;
+		EXPECT_LT(count, extend_all(p, opts).size());
+	}
+}
+TEST(PolytopeExtender, Domains) {
+	using ptope::calc::min_cos_angle;
+	Angles::get().set_angles({2, 3, 4, 5, 8});
+	PolytopeCandidate b(elliptic_factory::type_b(4));
+	auto q = b.extend_by_inner_products({ 0, 0, 0, min_cos_angle(8) });
+	ASSERT_TRUE(q.valid());
+	PolytopeExtender::Options opts;
+	opts.domains = InnerProductVectors::label_domains({ { 2, 3 }, { 2, 4, 5 },
+			{ 2, 3, 8 }, { 2, 3, 4, 5, 8 } });
+	/* The extensions using the domains are those of the full enumeration whose
+	 * products with the basis lie in the domains. */
+	std::vector<arma::mat> expected;
+	const arma::uword dim = q.real_dimension();
+	for(const arma::mat & gram : extend_all(q, PolytopeExtender::Options())) {
+		bool in_domains = true;
+		for(arma::uword i = 0; i < dim && in_domains; ++i) {
+			const double prod = gram(i, gram.n_cols - 1);
+			in_domains = std::any_of(opts.domains[i].begin(),
+					opts.domains[i].end(),
+					[prod](double d) { return std::abs(d - prod) < 1e-10; });
+		}
+		if(in_domains) {
+			expected.push_back(gram);
+		}
+	}
+	ASSERT_FALSE(expected.empty());
+	for(bool prune : { false, true }) {
+		opts.prune = prune;
+		expect_same(expected, extend_all(q, opts));
+	}
+	opts.symmetry = true;
+	EXPECT_GE(expected.size(), extend_all(q, opts).size());
+}
+namespace {
+/* Check that restricting the number of dotted edges gives the same extensions
+ * as filtering every extension with NumberDottedCheck. Returns the number of
+ * extensions found. */
+template <int N>
+std::size_t
+check_dotted(const PolytopeCandidate & p) {
+	NumberDottedCheck<N> check;
+	std::size_t count = 0;
+	for(bool gray : { false, true }) {
+		std::vector<arma::mat> expected;
+		PolytopeExtender::Options opts;
+		opts.prune = false;
+		opts.gray_code = gray;
+		PolytopeExtender full(p, opts);
+		while(full.has_next()) {
+			const PolytopeCandidate & c = full.next();
+			if(check(c)) {
+				expected.push_back(c.gram());
+			}
+		}
+		opts.dotted = InnerProductBounds::DottedRange(N, N);
+		expect_same(expected, extend_all(p, opts));
+		opts.prune = true;
+		expect_same(expected, extend_all(p, opts));
+		count = expected.size();
+	}
+	return count;
+}
+}
+TEST(PolytopeExtender, Dotted) {
+	using ptope::calc::min_cos_angle;
+	Angles::get().set_angles({2, 3, 4, 5, 8});
+	check_dotted<0>(elliptic_factory::type_b(4));
+	EXPECT_EQ(0u, check_dotted<1>(elliptic_factory::type_b(4)));
+
+	PolytopeCandidate b(elliptic_factory::type_b(4));
+	auto q = b.extend_by_inner_products({ min_cos_angle(8), min_cos_angle(4),
+			0, 0 });
+	ASSERT_TRUE(q.valid());
+	EXPECT_LT(0u, check_dotted<0>(q));
+	EXPECT_EQ(10u, check_dotted<1>(q));
+	EXPECT_EQ(0u, check_dotted<2>(q));
+	/* Requiring a dotted edge skips whole subtrees of inner products. */
+	PolytopeExtender::Options opts;
+	opts.dotted = InnerProductBounds::DottedRange(1, 1);
+	PolytopeExtender dotted(q, opts);
+	PolytopeExtender plain(q);
+	while(dotted.has_next()) {
+		dotted.next();
+	}
+	while(plain.has_next()) {
+		plain.next();
+	}
+	EXPECT_LT(plain.pruned_subtrees(), dotted.pruned_subtrees());
+}
+namespace {
+/* Check that asking for AngleCheck gives the same extensions as filtering
+ * every extension with it. Returns the number of extensions found. */
+std::size_t
+check_angles(const PolytopeCandidate & p) {
+	AngleCheck check;
+	std::size_t count = 0;
+	for(bool gray : { false, true }) {
+		std::vector<arma::mat> expected;
+		PolytopeExtender::Options opts;
+		opts.prune = false;
+		opts.gray_code = gray;
+		PolytopeExtender full(p, opts);
+		while(full.has_next()) {
+			const PolytopeCandidate & c = full.next();
+			if(check(c)) {
+				expected.push_back(c.gram());
+			}
+		}
+		opts.angles = true;
+		expect_same(expected, extend_all(p, opts));
+		opts.prune = true;
+		expect_same(expected, extend_all(p, opts));
+		count = expected.size();
+	}
+	return count;
+}
+}
+TEST(PolytopeExtender, Angles) {
+	using ptope::calc::min_cos_angle;
+	Angles::get().set_angles({2, 3, 4, 5, 8});
+	PolytopeCandidate b(elliptic_factory::type_b(4));
+	auto q = b.extend_by_inner_products({ min_cos_angle(8), min_cos_angle(4),
+			0, 0 });
+	ASSERT_TRUE(q.valid());
+	auto r = b.extend_by_inner_products({ 0, 0, 0, min_cos_angle(8) });
+	ASSERT_TRUE(r.valid());
+	for(const PolytopeCandidate & p : { q, r }) {
+		const std::size_t count = check_angles(p);
+		EXPECT_LT(0u, count);
+		EXPECT_GT(extend_all(p, PolytopeExtender::Options()).size(), count);
+	}
+	/* Products with the non-basis vectors which cannot be an angle skip whole
+	 * subtrees of inner products. */
+	PolytopeExtender::Options opts;
+	opts.angles = true;
+	PolytopeExtender angles(q, opts);
+	PolytopeExtender plain(q);
+	while(angles.has_next()) {
+		angles.next();
+	}
+	while(plain.has_next()) {
+		plain.next();
+	}
+	EXPECT_LT(plain.pruned_subtrees(), angles.pruned_subtrees());
+}
+}
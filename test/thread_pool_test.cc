@@ -0,0 +1,80 @@
+/*
+ * thread_pool_test.cc
+ * Copyright 2015 John Lawson
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+namespace ptope {
+TEST(ThreadPool, RunsAll) {
+	ThreadPool pool(4);
+	EXPECT_EQ(4u, pool.size());
+	std::atomic<int> sum(0);
+	for(int i = 1; i <= 100; ++i) {
+		pool.submit([&sum, i](std::size_t) { sum += i; });
+	}
+	pool.wait();
+	EXPECT_EQ(5050, sum);
+}
+namespace {
+/* Sum the integers in [begin, end) by splitting the range in half. */
+void
+split_sum(ThreadPool & pool, std::atomic<long> & sum, long begin, long end) {
+	while(end - begin > 8) {
+		const long mid = begin + (end - begin) / 2;
+		pool.submit([&pool, &sum, mid, end](std::size_t) {
+					split_sum(pool, sum, mid, end);
+				});
+		end = mid;
+	}
+	for(long i = begin; i < end; ++i) {
+		sum += i;
+	}
+}
+}
+TEST(ThreadPool, NestedSubmit) {
+	ThreadPool pool(3);
+	std::atomic<long> sum(0);
+	pool.submit([&pool, &sum](std::size_t) { split_sum(pool, sum, 0, 10000); });
+	pool.wait();
+	EXPECT_EQ(49995000, sum);
+	/* The pool can be reused once all tasks are done. */
+	sum = 0;
+	pool.submit([&pool, &sum](std::size_t) { split_sum(pool, sum, 0, 100); });
+	pool.wait();
+	EXPECT_EQ(4950, sum);
+}
+TEST(ThreadPool, Exception) {
+	ThreadPool pool(3);
+	std::atomic<int> count(0);
+	for(int i = 0; i < 20; ++i) {
+		pool.submit([&count, i](std::size_t) {
+					if(i == 7) {
+						throw std::runtime_error("task failed");
+					}
+					++count;
+				});
+	}
+	EXPECT_THROW(pool.wait(), std::runtime_error);
+	/* The other tasks still run, and the error is only reported once. */
+	EXPECT_EQ(19, count);
+	pool.submit([&count](std::size_t) { ++count; });
+	pool.wait();
+	EXPECT_EQ(20, count);
+}
+}